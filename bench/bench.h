@@ -0,0 +1,143 @@
+#pragma once
+
+// Minimal Google-Benchmark-style harness (no external dependency).
+//
+//   static void BM_Foo(bench::State& state) {
+//       for (auto _ : state) { bench::doNotOptimize(foo(state.range(0))); }
+//   }
+//   BENCHMARK(BM_Foo)->Arg(1)->Arg(10);
+//
+// Iteration counts are calibrated until the timed loop takes at least ~0.2 s.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+template <class T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+class State {
+public:
+    State(std::uint64_t iterations, std::int64_t arg) : iterations_(iterations), arg_(arg) {}
+
+    std::int64_t range(int = 0) const { return arg_; }
+    std::uint64_t iterations() const { return iterations_; }
+
+    void setItemsProcessed(std::uint64_t n) { items_ = n; }
+    void setBytesProcessed(std::uint64_t n) { bytes_ = n; }
+    std::uint64_t itemsProcessed() const { return items_; }
+    std::uint64_t bytesProcessed() const { return bytes_; }
+
+    // Only the loop body is timed: the clock starts in begin() and stops
+    // when the iterator reaches end(), so setup code is excluded.
+    double seconds() const { return std::chrono::duration<double>(stop_ - start_).count(); }
+
+    // Non-trivial destructor keeps 'for (auto _ : state)' free of unused-variable warnings
+    struct Value { ~Value() {} };
+    struct Iterator {
+        State* state;
+        std::uint64_t left;
+        bool operator!=(const Iterator&) {
+            if (left != 0) return true;
+            state->stop_ = std::chrono::steady_clock::now();
+            return false;
+        }
+        void operator++() { --left; }
+        Value operator*() const { return {}; }
+    };
+    Iterator begin() {
+        start_ = std::chrono::steady_clock::now();
+        return {this, iterations_};
+    }
+    Iterator end() { return {this, 0}; }
+
+private:
+    std::uint64_t iterations_;
+    std::int64_t arg_;
+    std::uint64_t items_ = 0;
+    std::uint64_t bytes_ = 0;
+    std::chrono::steady_clock::time_point start_, stop_;
+};
+
+using Function = void (*)(State&);
+
+struct Benchmark {
+    const char* name;
+    Function fn;
+    std::vector<std::int64_t> args;
+
+    Benchmark* Arg(std::int64_t a) { args.push_back(a); return this; }
+};
+
+inline std::vector<Benchmark*>& registry() {
+    static std::vector<Benchmark*> all;
+    return all;
+}
+
+inline Benchmark* registerBenchmark(const char* name, Function fn) {
+    auto* b = new Benchmark{name, fn, {}};
+    registry().push_back(b);
+    return b;
+}
+
+inline void runOne(const Benchmark& b, bool hasArg, std::int64_t arg) {
+    std::uint64_t iters = 1;
+    double seconds = 0;
+    State* last = nullptr;
+    for (;;) {
+        delete last;
+        last = new State(iters, arg);
+        b.fn(*last);
+        seconds = last->seconds();
+        if (seconds >= 0.2 || iters >= (1ull << 40)) break;
+        double scale = seconds > 0 ? 0.25 / seconds : 100.0;
+        if (scale > 100.0) scale = 100.0;
+        if (scale < 2.0) scale = 2.0;
+        iters = static_cast<std::uint64_t>(iters * scale);
+    }
+
+    std::string label = b.name;
+    if (hasArg) label += "/" + std::to_string(arg);
+    double ns = seconds * 1e9 / static_cast<double>(iters);
+    std::printf("%-36s %12.1f ns %12llu", label.c_str(), ns,
+                static_cast<unsigned long long>(iters));
+    if (last->itemsProcessed()) {
+        std::printf("   %8.2f M items/s", last->itemsProcessed() / seconds / 1e6);
+    }
+    if (last->bytesProcessed()) {
+        std::printf("   %8.1f MB/s", last->bytesProcessed() / seconds / 1e6);
+    }
+    std::printf("\n");
+    delete last;
+}
+
+// Runs all registered benchmarks whose name contains 'filter' (all if null)
+inline int runAll(const char* filter) {
+    std::printf("%-36s %15s %12s\n", "Benchmark", "Time", "Iterations");
+    std::printf("%s\n", std::string(66, '-').c_str());
+    for (const auto* b : registry()) {
+        if (filter && !std::strstr(b->name, filter)) continue;
+        if (b->args.empty()) {
+            runOne(*b, false, 0);
+        } else {
+            for (auto a : b->args) runOne(*b, true, a);
+        }
+    }
+    return 0;
+}
+
+} // namespace bench
+
+#define BENCH_CONCAT_(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_(a, b)
+#define BENCHMARK(fn) \
+    static ::bench::Benchmark* BENCH_CONCAT(bench_reg_, __LINE__) = ::bench::registerBenchmark(#fn, fn)
+#define BENCHMARK_MAIN() \
+    int main(int argc, char* argv[]) { return ::bench::runAll(argc > 1 ? argv[1] : nullptr); }
@@ -0,0 +1,99 @@
+// Checks formatSizeTo() against the snprintf implementation it replaced,
+// and appendJsonString() on file names that are not valid UTF-8.
+// Run with 'make check'; prints the first mismatches and exits 1 on any.
+
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <string_view>
+
+#include "appletree/format.h"
+#include "appletree/json.h"
+#include "formatsize_ref.h"
+
+using namespace appletree;
+
+namespace {
+
+std::uint64_t checked = 0;
+std::uint64_t mismatches = 0;
+
+void check(std::uint64_t v) {
+    char buf[kMaxSizeChars];
+    const std::string got(buf, formatSizeTo(buf, v));
+    const std::string want = formatSizeSnprintf(v);
+    ++checked;
+    if (got != want && ++mismatches <= 10) {
+        std::printf("mismatch for %llu: got '%s', want '%s'\n", static_cast<unsigned long long>(v), got.c_str(),
+                    want.c_str());
+    }
+}
+
+// 'center' and its neighbours, clamped to the 64-bit range
+void checkAround(std::uint64_t center, std::uint64_t radius) {
+    const std::uint64_t from = center > radius ? center - radius : 0;
+    const std::uint64_t to = center < UINT64_MAX - radius ? center + radius : UINT64_MAX;
+    for (std::uint64_t v = from;; ++v) {
+        check(v);
+        if (v == to) break;
+    }
+}
+
+// appendJsonString(name) must give exactly 'want'
+void checkJson(std::string_view name, std::string_view want) {
+    std::string got;
+    appendJsonString(got, name);
+    ++checked;
+    if (got != want && ++mismatches <= 10) {
+        std::printf("mismatch for JSON string: got %s, want %s\n", got.c_str(), std::string(want).c_str());
+    }
+}
+
+} // namespace
+
+int main() {
+    // Valid UTF-8 passes through, every other byte from 0x80 up becomes U+FFFD
+    checkJson("plain \"q\" \\ \n", "\"plain \\\"q\\\" \\\\ \\n\"");
+    checkJson("caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x8d\x8e", "\"caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x8d\x8e\"");
+    checkJson("\xff\xfe", "\"\\ufffd\\ufffd\"");                                 // never valid
+    checkJson("a\x80" "b", "\"a\\ufffdb\"");                                     // stray continuation byte
+    checkJson("\xc0\xaf", "\"\\ufffd\\ufffd\"");                                 // overlong '/'
+    checkJson("\xe0\x80\xaf", "\"\\ufffd\\ufffd\\ufffd\"");                      // overlong, 3 bytes
+    checkJson("\xed\xa0\x80", "\"\\ufffd\\ufffd\\ufffd\"");                      // UTF-16 surrogate
+    checkJson("\xf4\x90\x80\x80", "\"\\ufffd\\ufffd\\ufffd\\ufffd\"");           // above U+10FFFF
+    checkJson("x\xe2\x82", "\"x\\ufffd\\ufffd\"");                               // cut off at the end
+    checkJson("\xc3\x01", "\"\\ufffd\\u0001\"");                                 // lead byte, then a control
+    const std::uint64_t jsonMismatches = mismatches;
+    std::printf("appendJsonString: %llu names checked, %llu mismatches\n", static_cast<unsigned long long>(checked),
+                static_cast<unsigned long long>(mismatches));
+    checked = 0;
+
+    // Every small value: bytes, KiB and the first MiB
+    for (std::uint64_t v = 0; v < (std::uint64_t(1) << 22); ++v) check(v);
+
+    // Each unit: every displayed tenth / integer and the tie between two of
+    // them, where the rounding decides
+    for (int idx = 1; idx <= 6; ++idx) {
+        const int shift = 10 * idx;
+        for (std::uint64_t k = 1; k <= 10240; ++k) {
+            const unsigned __int128 base = static_cast<unsigned __int128>(k) << shift;
+            const unsigned __int128 value = base / 10;
+            const unsigned __int128 tie = (base * 2 + (std::uint64_t(1) << shift)) / 20;
+            if (value <= UINT64_MAX) checkAround(static_cast<std::uint64_t>(value), 16);
+            if (tie <= UINT64_MAX) checkAround(static_cast<std::uint64_t>(tie), 16);
+        }
+    }
+
+    // Large values, where doubles lose the low bits
+    for (int bit = 50; bit < 64; ++bit) checkAround(std::uint64_t(1) << bit, 4096);
+    checkAround(UINT64_MAX, 1 << 16);
+
+    // Random values of every magnitude (fixed seed: reproducible)
+    std::mt19937_64 rng(27);
+    for (int i = 0; i < 2000000; ++i) check(rng() >> (rng() % 64));
+
+    std::printf("formatSizeTo: %llu values checked, %llu mismatches\n", static_cast<unsigned long long>(checked),
+                static_cast<unsigned long long>(mismatches - jsonMismatches));
+    return mismatches == 0 ? 0 : 1;
+}
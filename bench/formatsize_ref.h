@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Pre-integer implementation of formatSize (double division + snprintf).
+// Baseline for the microbench and reference for 'make check'.
+inline std::string formatSizeSnprintf(std::uintmax_t bytes) {
+    static const char* units[] = {"B","KiB","MiB","GiB","TiB","PiB","EiB"};
+    double value = static_cast<double>(bytes);
+    int idx = 0;
+    while (value >= 1024.0 && idx < 6) {
+        value /= 1024.0;
+        ++idx;
+    }
+    char buf[32];
+    if (value < 10.0 && idx > 0) {
+        std::snprintf(buf, sizeof(buf), "%.1f %s", value, units[idx]);
+    } else {
+        std::snprintf(buf, sizeof(buf), "%.0f %s", value, units[idx]);
+    }
+    return std::string(buf);
+}
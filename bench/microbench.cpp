@@ -0,0 +1,203 @@
+// Microbenchmarks for the per-line / per-entry hot helpers.
+// Run with 'make microbench' (optionally: ./bench/microbench <name-filter>).
+
+#include <string>
+#include <vector>
+
+#include "appletree/filter.h"
+#include "appletree/format.h"
+#include "appletree/hash.h"
+#include "appletree/regex.h"
+#include "appletree/render.h"
+#include "bench.h"
+#include "formatsize_ref.h"
+
+using namespace appletree;
+
+namespace {
+
+// Sizes spread over all units so every branch of formatSize is hit
+std::vector<std::uintmax_t> sampleSizes() {
+    std::vector<std::uintmax_t> sizes;
+    std::uintmax_t x = 0x9E3779B97F4A7C15ull;
+    for (int i = 0; i < 1024; ++i) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        sizes.push_back(x >> (i % 64));
+    }
+    return sizes;
+}
+
+// 'n' literal patterns that never match, half plain names, half relative paths
+std::vector<std::string> literalPatterns(std::int64_t n) {
+    std::vector<std::string> patterns;
+    for (std::int64_t i = 0; i < n; ++i) {
+        if (i % 2) patterns.push_back("build/out-" + std::to_string(i));
+        else patterns.push_back("module_" + std::to_string(i));
+    }
+    return patterns;
+}
+
+// 'n' glob patterns that never match: suffix, prefix, "**/name" and general
+std::vector<std::string> globPatterns(std::int64_t n) {
+    std::vector<std::string> patterns;
+    for (std::int64_t i = 0; i < n; ++i) {
+        const std::string k = std::to_string(i);
+        switch (i % 4) {
+            case 0: patterns.push_back("*.ext" + k); break;
+            case 1: patterns.push_back("build-" + k + "-*"); break;
+            case 2: patterns.push_back("**/target" + k); break;
+            default: patterns.push_back("out/*/gen" + k + "/*.o"); break;
+        }
+    }
+    return patterns;
+}
+
+template <class Filter>
+Filter makeFilter(const std::vector<std::string>& patterns) {
+    Filter f;
+    for (const auto& p : patterns) f.add(p);
+    f.compile();
+    return f;
+}
+
+struct Entry { std::string filename, rel; };
+
+std::vector<Entry> sampleEntries() {
+    std::vector<Entry> entries;
+    for (int i = 0; i < 256; ++i) {
+        std::string name = "file_" + std::to_string(i) + ".cpp";
+        entries.push_back({name, "src/module/sub" + std::to_string(i % 7) + "/" + name});
+    }
+    return entries;
+}
+
+void BM_FormatSizeSnprintf(bench::State& state) {
+    auto sizes = sampleSizes();
+    std::size_t i = 0;
+    for (auto _ : state) {
+        bench::doNotOptimize(formatSizeSnprintf(sizes[i++ & 1023]));
+    }
+    state.setItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FormatSizeSnprintf);
+
+void BM_FormatSize(bench::State& state) {
+    auto sizes = sampleSizes();
+    std::size_t i = 0;
+    for (auto _ : state) {
+        bench::doNotOptimize(formatSize(sizes[i++ & 1023]));
+    }
+    state.setItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FormatSize);
+
+// Allocation-free path used by the renderer
+void BM_FormatSizeTo(bench::State& state) {
+    auto sizes = sampleSizes();
+    char buf[kMaxSizeChars];
+    std::size_t i = 0;
+    for (auto _ : state) {
+        bench::doNotOptimize(formatSizeTo(buf, sizes[i++ & 1023]));
+        bench::doNotOptimize(buf[0]);
+    }
+    state.setItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FormatSizeTo);
+
+void BM_FilterExclude(bench::State& state) {
+    auto filter = makeFilter<ExcludeFilter>(literalPatterns(state.range(0)));
+    auto entries = sampleEntries();
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const auto& e = entries[i++ & 255];
+        bench::doNotOptimize(filter.matches(e.filename, e.rel));
+    }
+    state.setItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FilterExclude)->Arg(1)->Arg(10)->Arg(100)->Arg(1000);
+
+void BM_FilterOnly(bench::State& state) {
+    auto filter = makeFilter<OnlyFilter>(literalPatterns(state.range(0)));
+    auto entries = sampleEntries();
+    std::size_t i = 0;
+    for (auto _ : state) {
+        bench::doNotOptimize(filter.match(entries[i++ & 255].rel, false));
+    }
+    state.setItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FilterOnly)->Arg(1)->Arg(10)->Arg(100)->Arg(1000);
+
+void BM_GlobExclude(bench::State& state) {
+    auto filter = makeFilter<ExcludeFilter>(globPatterns(state.range(0)));
+    auto entries = sampleEntries();
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const auto& e = entries[i++ & 255];
+        bench::doNotOptimize(filter.matches(e.filename, e.rel));
+    }
+    state.setItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GlobExclude)->Arg(1)->Arg(10)->Arg(100)->Arg(1000);
+
+void BM_GlobOnly(bench::State& state) {
+    auto filter = makeFilter<OnlyFilter>(globPatterns(state.range(0)));
+    auto entries = sampleEntries();
+    std::size_t i = 0;
+    for (auto _ : state) {
+        bench::doNotOptimize(filter.match(entries[i++ & 255].rel, false));
+    }
+    state.setItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GlobOnly)->Arg(1)->Arg(10)->Arg(100)->Arg(1000);
+
+// 'n' regexes that never match, including ones that backtrack badly elsewhere
+void BM_RegexExclude(bench::State& state) {
+    RegexFilter filter;
+    std::string error;
+    for (std::int64_t i = 0; i < state.range(0); ++i) {
+        const std::string k = std::to_string(i);
+        filter.add(i % 2 ? "(a|aa)*b" + k + "$" : "^out/.*/gen" + k + "\\.o$", error);
+    }
+    filter.compile();
+    auto entries = sampleEntries();
+    std::size_t i = 0;
+    for (auto _ : state) {
+        bench::doNotOptimize(filter.matches(entries[i++ & 255].rel));
+    }
+    state.setItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RegexExclude)->Arg(1)->Arg(10)->Arg(100)->Arg(1000);
+
+// Renders one line at the given depth, including prefix + size suffix
+void BM_RenderLine(bench::State& state) {
+    std::string prefix;
+    for (std::int64_t d = 0; d < state.range(0); ++d) prefix += vertical(Theme::classic, d % 2);
+    const std::string name = "utils.cpp";
+    std::string line;
+    std::uint64_t bytes = 0;
+    for (auto _ : state) {
+        line.clear();
+        appendTreeLine(line, prefix, false, name, false, std::uintmax_t(12345), Theme::classic);
+        bytes += line.size();
+        bench::doNotOptimize(line.data());
+    }
+    state.setItemsProcessed(state.iterations());
+    state.setBytesProcessed(bytes);
+}
+BENCHMARK(BM_RenderLine)->Arg(1)->Arg(4)->Arg(16);
+
+// Content hash used by --dupes, over buffers from 4 KiB (edge hash) to 1 MiB (one read block)
+void BM_Xxh64(bench::State& state) {
+    std::vector<unsigned char> data(static_cast<std::size_t>(state.range(0)));
+    for (std::size_t i = 0; i < data.size(); ++i) data[i] = static_cast<unsigned char>(i * 131);
+    for (auto _ : state) {
+        bench::doNotOptimize(xxh64(data.data(), data.size()));
+    }
+    state.setItemsProcessed(state.iterations());
+    state.setBytesProcessed(state.iterations() * static_cast<std::uint64_t>(data.size()));
+}
+BENCHMARK(BM_Xxh64)->Arg(4096)->Arg(1 << 20);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,158 @@
+// Checks that every walk of the scanner reports the same folder sizes:
+// stream() and scan() + render(), depth- and breadth-first, with and without
+// a budget that is never reached, '--format json' and 'ndjson', and
+// Scanner::size() (--progressive). Also that a file name that is not UTF-8
+// still gives valid JSON. Builds a
+// small tree in a temporary folder; run with 'make check', exits 1 on any
+// mismatch.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "appletree/budget.h"
+#include "appletree/render.h"
+#include "appletree/scan.h"
+#include "appletree/writer.h"
+
+using namespace appletree;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+int checked = 0;
+int mismatches = 0;
+
+void expect(bool ok, const std::string& what) {
+    ++checked;
+    if (!ok && ++mismatches <= 10) std::printf("mismatch: %s\n", what.c_str());
+}
+
+void writeFile(const fs::path& path, std::size_t bytes) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << std::string(bytes, 'x');
+}
+
+// Files of distinct sizes on several levels, folders that the filters below
+// drop, a link to a folder (drawn, not counted) and one to a file, and
+// .gitignore files on two levels and a name that is not UTF-8
+void makeTree(const fs::path& root) {
+    std::ofstream(root / ".gitignore") << "node_modules/\n*.o\n";
+    writeFile(root / "README.md", 10);
+    writeFile(root / ".env", 20);
+    writeFile(root / "build-1" / "big.bin", 5000);
+    writeFile(root / "docs" / "guide.md", 300);
+    writeFile(root / "docs" / "\xff\xfe.txt", 40);
+    writeFile(root / "node_modules" / "pkg" / "index.js", 4000);
+    writeFile(root / "src" / "main.cpp", 600);
+    writeFile(root / "src" / "main.o", 7000);
+    writeFile(root / "src" / "util" / "log.h", 80);
+    writeFile(root / "src" / "util" / "deep" / "x" / "y.txt", 9);
+    std::ofstream(root / "src" / "util" / ".gitignore") << "deep\n";
+    fs::create_directory_symlink("src", root / "src-link");
+    fs::create_symlink("src/main.cpp", root / "main-link");
+}
+
+std::string render(const fs::path& root, const ScanOptions& options, Format format, bool stream) {
+    OutputWriter capture(-1);
+    RenderOptions renderOptions;
+    renderOptions.format = format;
+    renderOptions.sizes = true;
+    auto renderer = makeRenderer(capture, renderOptions);
+    const Scanner scanner(options);
+    if (stream) scanner.stream(root, *renderer);
+    else renderer->render(scanner.scan(root));
+    return std::move(capture.buffer());
+}
+
+// The first "size" in 'text' (the root's, in both JSON formats)
+std::string rootSize(const std::string& text) {
+    std::size_t at = text.find("\"size\":");
+    if (at == std::string::npos) return "none";
+    at += 7;
+    return text.substr(at, text.find_first_not_of("0123456789", at) - at);
+}
+
+// Runs one filter setup through every walk and compares with the default.
+// 'leftOut': the bytes the setup does not count (--gitignore).
+void checkWalks(const fs::path& root, const std::string& name, const std::function<void(ScanOptions&)>& setup,
+                std::uintmax_t leftOut = 0) {
+    ScanOptions options;
+    options.sizes = true;
+    setup(options);
+    options.compile();
+
+    const std::string tree = render(root, options, Format::ndjson, false);
+    expect(render(root, options, Format::ndjson, true) == tree, name + ": stream() vs scan()");
+
+    ScanOptions bfs = options;
+    bfs.breadthFirst = true;
+    expect(render(root, bfs, Format::ndjson, false) == tree, name + ": --bfs vs depth-first");
+
+    ScanBudget budget(std::chrono::milliseconds(600000), std::size_t(1) << 40);
+    ScanOptions budgeted = options;
+    budgeted.budget = &budget;
+    expect(render(root, budgeted, Format::ndjson, true) == tree, name + ": unspent budget vs none");
+
+    expect(rootSize(render(root, options, Format::json, true)) == rootSize(tree), name + ": json vs ndjson");
+
+    // Folder sizes count everything below, whatever is printed
+    expect(rootSize(tree) == std::to_string(dirSizeRecursive(root) - leftOut), name + ": root size vs dirSizeRecursive()");
+
+    // Sized one folder at a time, as --progressive does
+    const Scanner scanner(options);
+    expect(std::to_string(scanner.size(root, root)) == rootSize(tree), name + ": Scanner::size() vs scan()");
+    for (const Node& child : scanner.scan(root).root.children) {
+        if (child.type != EntryType::directory || !child.size) continue;
+        expect(scanner.size(root, root / child.name) == *child.size, name + ": Scanner::size() of " + child.name);
+    }
+}
+
+} // namespace
+
+int main() {
+    char dir[] = "/tmp/appletree-check-XXXXXX";
+    if (!::mkdtemp(dir)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    const fs::path root = dir;
+    makeTree(root);
+
+    checkWalks(root, "no filter", [](ScanOptions&) {});
+    checkWalks(root, "-e build-1", [](ScanOptions& o) { o.exclude.add("build-1"); });
+    checkWalks(root, "-e . -e node_modules", [](ScanOptions& o) { o.exclude.add("."); o.exclude.add("node_modules"); });
+    checkWalks(root, "-o src", [](ScanOptions& o) { o.only.add("src"); });
+    checkWalks(root, "-o '**/log.h'", [](ScanOptions& o) { o.only.add("**/log.h"); });
+    checkWalks(root, "--only-re 'main'", [](ScanOptions& o) { std::string e; o.onlyRegex.add("main", e); });
+    checkWalks(root, "-e build-1 -d 1", [](ScanOptions& o) { o.exclude.add("build-1"); o.maxDepth = 1; });
+    checkWalks(root, "-e src/util -d 2", [](ScanOptions& o) { o.exclude.add("src/util"); o.maxDepth = 2; });
+    checkWalks(root, "--min-size 0 -e docs", [](ScanOptions& o) { o.predicates.minSize = 0; o.exclude.add("docs"); });
+
+    // Ignored entries are left out everywhere, folded subtrees included
+    const std::uintmax_t ignored = 4000 + 7000 + 9;
+    checkWalks(root, "--gitignore", [](ScanOptions& o) { o.gitignore = true; }, ignored);
+    checkWalks(root, "--gitignore -d 1", [](ScanOptions& o) { o.gitignore = true; o.maxDepth = 1; }, ignored);
+    checkWalks(root, "--gitignore -e src", [](ScanOptions& o) { o.gitignore = true; o.exclude.add("src"); }, ignored);
+    checkWalks(root, "--gitignore -o docs", [](ScanOptions& o) { o.gitignore = true; o.only.add("docs"); }, ignored);
+
+    // The name is written as U+FFFD twice, never as raw bytes
+    ScanOptions options;
+    options.compile();
+    for (Format format : {Format::json, Format::ndjson}) {
+        const std::string text = render(root, options, format, true);
+        expect(text.find("\\ufffd\\ufffd.txt\"") != std::string::npos, "JSON name of '\\xff\\xfe.txt'");
+        expect(text.find('\xff') == std::string::npos, "no raw 0xff in JSON output");
+    }
+
+    fs::remove_all(root);
+    std::printf("scan walks: %d comparisons, %d mismatches\n", checked, mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
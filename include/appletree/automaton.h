@@ -0,0 +1,76 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace appletree {
+
+// Thompson NFA over bytes. Every state has at most one byte transition
+// (any byte in 'bytes' leads to 'next') plus any number of epsilon edges.
+struct NfaState {
+    std::bitset<256> bytes;
+    int next = -1;
+    std::vector<int> eps;
+    int accept = -1;   // pattern id if this is a final state
+};
+
+class Nfa {
+public:
+    int add() {
+        states_.emplace_back();
+        return static_cast<int>(states_.size()) - 1;
+    }
+    NfaState& operator[](int i) { return states_[i]; }
+    const NfaState& operator[](int i) const { return states_[i]; }
+    int size() const { return static_cast<int>(states_.size()); }
+
+    // Entry state of one pattern; all patterns are matched simultaneously
+    void addStart(int state) { starts_.push_back(state); }
+    const std::vector<int>& starts() const { return starts_; }
+
+private:
+    std::vector<NfaState> states_;
+    std::vector<int> starts_;
+};
+
+// Outcome of feeding one string through a Dfa. Pattern ids: when several
+// patterns match, the highest id wins (-1 = none).
+struct DfaRun {
+    int acceptEnd = -1;        // a pattern matches the whole input
+    int acceptBoundary = -1;   // ... the input up to some '/' or its end
+    int acceptAny = -1;        // ... any prefix of the input
+    bool liveBelow = false;    // input + "/..." could still match
+};
+
+// How an entry fares against an "only" filter (-o, --only-re)
+enum class OnlyMatch {
+    none,       // dropped
+    match,      // kept: matches, lies below a match or leads to a literal one
+    below,      // kept for now: a folder a match could lie in; dropped again
+                // if nothing inside it is kept
+};
+
+// DFA over byte equivalence classes, built lazily from an Nfa: a state is
+// created the first time an input reaches it, so compiling thousands of
+// patterns costs nothing up front. Once 'maxStates' exist, new transitions
+// are simulated on the NFA instead; matching stays linear in the input
+// length for any pattern set. Safe to share between threads: cached
+// transitions are read lock-free, only cache misses take a mutex.
+class Dfa {
+public:
+    Dfa() = default;
+    explicit Dfa(Nfa nfa, std::size_t maxStates = 4096);
+
+    bool empty() const { return !impl_; }
+    DfaRun run(std::string_view s) const;
+
+private:
+    struct Impl;
+    std::shared_ptr<Impl> impl_;
+};
+
+} // namespace appletree
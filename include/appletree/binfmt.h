@@ -0,0 +1,205 @@
+#pragma once
+
+// Compact binary output ('--format bin') for tool-to-tool pipelines.
+//
+// Stream layout, all integers little-endian:
+//
+//   header   "ATRB" + u32 version
+//   record*  u32 recordSize   whole record incl. this field and padding
+//            u32 depth        0 = root, entries follow in pre-order
+//            u64 size         valid if flags & kBinHasSize
+//            i64 mtime        seconds since the epoch
+//            u8  type         EntryType
+//            u8  flags
+//            u16 nameLength
+//            name bytes       basename, not NUL-terminated
+//            padding          up to the next multiple of 8
+//            u64 dev          only if flags & kBinHasHash: the file's identity
+//            u64 ino          as '--hash-cache' matches it on the next run
+//            i64 mtimeNs      mtime and ctime in nanoseconds since the epoch
+//            i64 ctimeNs
+//            u64 hash         only if flags & kBinHasHash ('--hash' content/Merkle hash)
+//
+// Records are 8-byte aligned so a reader can decode them in place from an
+// mmap()ed file. The reader part of this header has no dependency on the
+// rest of appletree and can be copied into consuming projects as is.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace appletree {
+
+constexpr char kBinMagic[4] = {'A', 'T', 'R', 'B'};
+constexpr std::uint32_t kBinVersion = 2;
+constexpr std::size_t kBinHeaderSize = 8;
+constexpr std::size_t kBinRecordFixedSize = 28;
+constexpr std::uint8_t kBinHasSize = 1;
+constexpr std::uint8_t kBinHasHash = 2;
+constexpr std::size_t kBinHashBlockSize = 40;
+
+// ---- Reader (header-only) ----
+
+// One decoded record; 'name' points into the underlying buffer
+struct BinRecord {
+    std::uint32_t depth;
+    std::uint64_t size;
+    std::int64_t mtime;
+    std::uint8_t type;
+    std::uint8_t flags;
+    std::string_view name;
+    std::uint64_t dev;            // valid if hasHash()
+    std::uint64_t ino;
+    std::int64_t mtimeNs;
+    std::int64_t ctimeNs;
+    std::uint64_t hash;
+
+    bool hasSize() const { return flags & kBinHasSize; }
+    bool hasHash() const { return flags & kBinHasHash; }
+};
+
+namespace binfmt_detail {
+
+inline std::uint64_t loadLE(const unsigned char* p, int bytes) {
+    std::uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+
+} // namespace binfmt_detail
+
+// Iterates the records of an in-memory stream without copying
+class BinReader {
+public:
+    BinReader(const void* data, std::size_t len)
+        : p_(static_cast<const unsigned char*>(data)), end_(p_ + len) {
+        if (len >= kBinHeaderSize && std::memcmp(p_, kBinMagic, 4) == 0) {
+            version_ = static_cast<std::uint32_t>(binfmt_detail::loadLE(p_ + 4, 4));
+        }
+        valid_ = version_ == kBinVersion;
+        if (valid_) p_ += kBinHeaderSize;
+    }
+
+    // False if the header is missing or has an unknown version, or once
+    // next() met a truncated or malformed record
+    bool valid() const { return valid_; }
+
+    // The version in the header; 0 if there is no header
+    std::uint32_t version() const { return version_; }
+
+    // True once every byte was decoded; after next() returned false this
+    // tells a clean end from a truncated stream
+    bool atEnd() const { return valid_ && p_ == end_; }
+
+    // Decodes the next record; false at the end or on a truncated record
+    bool next(BinRecord& rec) {
+        using binfmt_detail::loadLE;
+        if (!valid_ || p_ == end_) return false;
+        if (static_cast<std::size_t>(end_ - p_) < kBinRecordFixedSize) {
+            valid_ = false;
+            return false;
+        }
+        std::uint32_t recordSize = static_cast<std::uint32_t>(loadLE(p_, 4));
+        std::uint16_t nameLength = static_cast<std::uint16_t>(loadLE(p_ + 26, 2));
+        if (recordSize < kBinRecordFixedSize + nameLength
+            || recordSize > static_cast<std::size_t>(end_ - p_)) {
+            valid_ = false;
+            return false;
+        }
+        rec.depth = static_cast<std::uint32_t>(loadLE(p_ + 4, 4));
+        rec.size = loadLE(p_ + 8, 8);
+        rec.mtime = static_cast<std::int64_t>(loadLE(p_ + 16, 8));
+        rec.type = p_[24];
+        rec.flags = p_[25];
+        rec.name = std::string_view(reinterpret_cast<const char*>(p_ + kBinRecordFixedSize), nameLength);
+        rec.dev = rec.ino = rec.hash = 0;
+        rec.mtimeNs = rec.ctimeNs = 0;
+        if (rec.flags & kBinHasHash) {
+            std::size_t at = (kBinRecordFixedSize + nameLength + 7) & ~std::size_t(7);
+            if (at + kBinHashBlockSize <= recordSize) {
+                rec.dev = loadLE(p_ + at, 8);
+                rec.ino = loadLE(p_ + at + 8, 8);
+                rec.mtimeNs = static_cast<std::int64_t>(loadLE(p_ + at + 16, 8));
+                rec.ctimeNs = static_cast<std::int64_t>(loadLE(p_ + at + 24, 8));
+                rec.hash = loadLE(p_ + at + 32, 8);
+            } else {
+                rec.flags &= static_cast<std::uint8_t>(~kBinHasHash);
+            }
+        }
+        p_ += recordSize;
+        return true;
+    }
+
+private:
+    const unsigned char* p_;
+    const unsigned char* end_;
+    std::uint32_t version_ = 0;
+    bool valid_ = false;
+};
+
+// Read-only mmap() of a whole file, for use with BinReader
+class BinFile {
+public:
+    explicit BinFile(const char* path) {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* m = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (m != MAP_FAILED) {
+                data_ = m;
+                size_ = static_cast<std::size_t>(st.st_size);
+                ::madvise(m, size_, MADV_SEQUENTIAL);
+            }
+        }
+        ::close(fd);
+    }
+    ~BinFile() {
+        if (data_) ::munmap(data_, size_);
+    }
+
+    BinFile(const BinFile&) = delete;
+    BinFile& operator=(const BinFile&) = delete;
+
+    bool ok() const { return data_ != nullptr; }
+    BinReader reader() const { return BinReader(data_, size_); }
+
+private:
+    void* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+// ---- Writer (src/binfmt.cpp) ----
+
+// Appends the stream header
+void appendBinHeader(std::string& out);
+
+// Appends one record; 'size' is only stored if 'hasSize', the file's
+// identity (dev to ctimeNs) and 'hash' only if 'hasHash'
+void appendBinRecord(std::string& out, std::uint32_t depth, std::uint8_t type,
+                     bool hasSize, std::uint64_t size, std::int64_t mtime,
+                     std::string_view name, bool hasHash = false,
+                     std::uint64_t dev = 0, std::uint64_t ino = 0, std::int64_t mtimeNs = 0,
+                     std::int64_t ctimeNs = 0, std::uint64_t hash = 0);
+
+// ---- Snapshot loading (src/binfmt.cpp) ----
+
+struct Node;
+
+// Rebuilds the tree of a saved '--format bin' stream into 'root'. Entries
+// with children are marked isDir; sizes, file identities and hashes are
+// kept where they were stored.
+bool loadBinTree(const std::string& path, Node& root, std::string& error);
+
+// Writes 'root' as a '--format bin' stream to 'path' (via a temporary file
+// and rename(), so readers never see a partial snapshot)
+bool saveBinTree(const std::string& path, const Node& root, std::string& error);
+
+} // namespace appletree
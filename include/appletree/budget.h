@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace appletree {
+
+// Limits shared by every scan of one run ('--timeout', '--max-entries-total').
+// Scans running on different threads charge the same counters; once the
+// budget is spent no further folder is read and the scans return what they
+// have, with the folders they skipped marked as not scanned.
+class ScanBudget {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    ScanBudget(std::optional<std::chrono::milliseconds> timeout, std::optional<std::size_t> maxEntries);
+
+    bool hasDeadline() const { return hasDeadline_; }
+    Clock::time_point deadline() const { return deadline_; }
+
+    // Entries that may still be read; SIZE_MAX without a limit
+    std::size_t remaining() const;
+
+    // Counts 'n' directory entries read
+    void charge(std::size_t n) { used_.fetch_add(n, std::memory_order_relaxed); }
+
+    // True once the time is up or the entries are used up (and from then on)
+    bool spent();
+
+    // Called when a read was abandoned at the deadline
+    void expire() { timedOut_.store(true, std::memory_order_relaxed); spent_.store(true, std::memory_order_relaxed); }
+
+    bool timedOut() const { return timedOut_.load(std::memory_order_relaxed); }
+
+private:
+    bool hasDeadline_ = false;
+    Clock::time_point deadline_;
+    std::optional<std::size_t> maxEntries_;
+    std::atomic<std::size_t> used_{0};
+    std::atomic<bool> spent_{false};
+    std::atomic<bool> timedOut_{false};
+};
+
+// "500ms", "5s", "2m", "1h"; a plain number means seconds
+bool parseDurationArg(const std::string& s, std::chrono::milliseconds& duration);
+
+// One entry as read from a directory
+struct DirEntry {
+    std::filesystem::path path;
+    bool isDir = false;           // follows links
+    bool isLink = false;
+};
+
+// Reads up to 'limit' entries of 'dir' into 'out' (unsorted); false if the
+// limit cut the listing short
+bool readDirectory(const std::filesystem::path& dir, std::vector<DirEntry>& out, std::size_t limit);
+
+// Runs readDirectory() on a helper thread and waits for it no longer than
+// the deadline, so a read stuck on a hung mount cannot block the scan. An
+// abandoned read keeps its thread until the kernel returns; the result is
+// dropped. One reader per scan: read() is not reentrant.
+class DirReader {
+public:
+    explicit DirReader(ScanBudget::Clock::time_point deadline);
+    ~DirReader();
+
+    DirReader(const DirReader&) = delete;
+    DirReader& operator=(const DirReader&) = delete;
+
+    enum class Result {complete, cut, timedOut};
+    Result read(const std::filesystem::path& dir, std::vector<DirEntry>& out, std::size_t limit);
+
+private:
+    struct Shared;
+    std::shared_ptr<Shared> shared_;
+    ScanBudget::Clock::time_point deadline_;
+    bool abandoned_ = false;
+};
+
+} // namespace appletree
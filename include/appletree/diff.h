@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "appletree/render.h"
+#include "appletree/tree.h"
+#include "appletree/writer.h"
+
+namespace appletree {
+
+// What changed about one entry between two trees ('--diff')
+enum DiffChange : std::uint8_t {
+    kDiffAdded   = 1,
+    kDiffRemoved = 2,
+    kDiffSize    = 4,   // regular files only
+    kDiffMtime   = 8,   // regular files and links
+};
+
+// One entry of the merged tree. Only changed entries and the directories
+// leading to them are kept; added/removed directories are not expanded.
+struct DiffNode {
+    std::string name;
+    bool isDir = false;
+    std::uint8_t change = 0;              // DiffChange bits, 0 = just a parent
+    std::optional<std::uintmax_t> oldSize;
+    std::optional<std::uintmax_t> newSize;
+    std::vector<DiffNode> children;
+};
+
+struct DiffCounts {
+    std::size_t added = 0;
+    std::size_t removed = 0;
+    std::size_t changed = 0;
+};
+
+// Sets every directory's size to the total of the regular files below it
+// and 'digest' to a fingerprint of the names, types, sizes and mtimes in its
+// subtree (file mtimes only; a directory's own mtime is ignored). Needed by
+// diffTrees().
+void aggregateTree(Node& node);
+
+// Merges the sorted children of 'before' and 'after' in one linear walk.
+// Directories whose aggregated size and digest match are treated as
+// identical and not descended into.
+DiffNode diffTrees(const Node& before, const Node& after, DiffCounts& counts);
+
+// Draws the merged tree with '+' added, '-' removed, '~' size changed and
+// '*' mtime changed markers, followed by a summary line; ANSI styles only
+// with 'color'
+void writeDiffTree(OutputWriter& out, const DiffNode& root, const std::string& beforeLabel,
+                   const std::string& afterLabel, const DiffCounts& counts, Theme theme,
+                   bool color);
+
+} // namespace appletree
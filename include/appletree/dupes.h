@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "appletree/pool.h"
+#include "appletree/render.h"
+#include "appletree/tree.h"
+#include "appletree/writer.h"
+
+namespace appletree {
+
+// Regular files with identical content ('--dupes')
+struct DupeGroup {
+    std::uintmax_t size = 0;
+    std::uint64_t hash = 0;               // XXH64 of the content (the bytes were compared too)
+    std::vector<const Node*> files;       // sorted by path; the first counts as the original
+    std::vector<std::string> paths;       // relative to the root, same order
+    std::vector<bool> extra;              // wastes space: not the first path, nor a hard link to an earlier one
+    std::size_t copies = 0;               // distinct inodes
+
+    std::uintmax_t wasted() const { return size * (copies - 1); }
+};
+
+// Finds duplicate files in 'tree' in four rounds, each only over the
+// survivors of the previous one: equal size, equal hash of the first and
+// last 4 KiB, equal hash of the whole content, equal bytes (compared with
+// the first file of each content; hard links are not read again). Hashing
+// and comparing run on 'pool'. Empty files are skipped. Groups are sorted by wasted bytes, largest first.
+std::vector<DupeGroup> findDuplicates(const Tree& tree, ThreadPool& pool);
+
+// The scanned tree reduced to duplicate files ("name [#group] (size)") and
+// their folders, each folder with the bytes wasted below it; ANSI styles
+// only with 'color'
+void writeDupesTree(OutputWriter& out, const Tree& tree, const std::vector<DupeGroup>& groups, Theme theme,
+                    bool color);
+
+// One NDJSON line per group: group, size, wasted, hash, paths
+void writeDupesNdjson(OutputWriter& out, const std::vector<DupeGroup>& groups);
+
+} // namespace appletree
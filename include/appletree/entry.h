@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <sys/types.h>
+
+namespace appletree {
+
+// Kind of a directory entry, as reported by lstat()
+enum class EntryType : std::uint8_t {file, directory, symlink, fifo, socket, block, character, other};
+
+// Maps st_mode to an EntryType
+EntryType entryTypeFromMode(mode_t mode);
+
+// Name used by the machine-readable formats ("file", "directory", "link", ...)
+const char* entryTypeName(EntryType type);
+
+} // namespace appletree
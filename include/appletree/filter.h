@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "appletree/automaton.h"
+
+namespace appletree {
+
+// Set of literal strings; lookups take string_views so probing a substring
+// of a name or path never allocates.
+class LiteralSet {
+public:
+    LiteralSet() = default;
+    LiteralSet(const LiteralSet& other) { *this = other; }
+    LiteralSet& operator=(const LiteralSet& other);
+    LiteralSet(LiteralSet&&) = default;
+    LiteralSet& operator=(LiteralSet&&) = default;
+
+    void add(std::string s);
+    bool empty() const { return set_.empty(); }
+
+    bool contains(std::string_view s) const { return set_.count(s) != 0; }
+    // Some member is a prefix / suffix of 's'
+    bool containsPrefixOf(std::string_view s) const;
+    bool containsSuffixOf(std::string_view s) const;
+    // 's' or one of its ancestors ("a/b" for "a/b/c") is a member
+    bool containsPathOrAncestor(std::string_view s) const;
+
+private:
+    std::deque<std::string> storage_;   // stable addresses for the views below
+    std::unordered_set<std::string_view> set_;
+    std::vector<std::size_t> lengths_;  // distinct member lengths, ascending
+};
+
+// Basename patterns, compiled into buckets: exact names, "*suffix",
+// "prefix*", and one combined DFA for every other glob. The per-name cost
+// depends on the number of distinct affix lengths, not on the pattern count.
+class NameMatcher {
+public:
+    void add(const std::string& pattern);
+    void compile();
+
+    bool empty() const;
+    bool matches(std::string_view name) const;
+
+private:
+    LiteralSet exact_;
+    LiteralSet suffixes_;
+    LiteralSet prefixes_;
+    std::vector<std::string> globs_;
+    Dfa dfa_;
+};
+
+// Compiled '-e' patterns. Plain names and "**/name" match the basename
+// anywhere; patterns containing '/' match the relative path (and its
+// subtree); '.' hides dotfiles.
+class ExcludeFilter {
+public:
+    void add(const std::string& pattern);
+    void compile();   // after the last add()
+
+    bool empty() const { return !hideDot_ && names_.empty() && paths_.empty() && pathDfa_.empty(); }
+    bool hidesDotfiles() const { return hideDot_; }
+
+    // True for names hidden by '-e .'
+    bool isHidden(std::string_view filename) const {
+        return hideDot_ && !filename.empty() && filename[0] == '.';
+    }
+
+    bool matches(std::string_view filename, std::string_view rel) const;
+
+private:
+    bool hideDot_ = false;
+    NameMatcher names_;
+    LiteralSet paths_;
+    std::vector<std::string> pathGlobs_;
+    Dfa pathDfa_;
+};
+
+// Compiled '-o' patterns (relative paths or path globs)
+class OnlyFilter {
+public:
+    void add(const std::string& pattern);
+    void compile();   // after the last add()
+
+    bool empty() const { return paths_.empty() && anywhere_.empty() && pathDfa_.empty(); }
+
+    // match if the entry matches, lies below a match, or is a parent folder
+    // of a literal match; below for a directory a glob could still match
+    // something inside of
+    OnlyMatch match(std::string_view rel, bool isDir) const;
+
+    // Some pattern is a glob, so match() may return OnlyMatch::below
+    bool keepsFoldersBelow() const { return !anywhere_.empty() || !pathDfa_.empty(); }
+
+private:
+    LiteralSet paths_;
+    LiteralSet parents_;
+    NameMatcher anywhere_;   // "**/name"
+    std::vector<std::string> pathGlobs_;
+    Dfa pathDfa_;
+};
+
+} // namespace appletree
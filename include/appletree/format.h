@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace appletree {
+
+// Longest output of formatSizeTo ("1024 KiB"), plus slack
+constexpr std::size_t kMaxSizeChars = 16;
+
+// Writes a human readable size with binary units ("512 B", "4.2 KiB", "37 MiB")
+// to 'out' (at least kMaxSizeChars bytes) and returns the end of the text.
+// Integer-only; rounds exactly like printf("%.1f") / printf("%.0f") on the
+// double value did.
+char* formatSizeTo(char* out, std::uintmax_t bytes);
+
+// Writes the decimal digits of 'v' to 'out' (at least 20 bytes), returns the end
+char* formatUnsignedTo(char* out, std::uint64_t v);
+
+// Appends 'v' as 16 lowercase hex digits (content hashes)
+void appendHex64(std::string& out, std::uint64_t v);
+
+// Appends formatSizeTo() output to 'out'
+void appendSize(std::string& out, std::uintmax_t bytes);
+
+// Appends 'v' with thousands separators ("48,213")
+void appendGrouped(std::string& out, std::uint64_t v);
+
+// Appends an age in seconds in its largest whole unit ("45s", "12m", "3h",
+// "5d", "4mo", "2y"); negative ages count as 0
+void appendAge(std::string& out, std::int64_t seconds);
+
+// Convenience wrapper returning a new string
+std::string formatSize(std::uintmax_t bytes);
+
+} // namespace appletree
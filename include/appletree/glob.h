@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string_view>
+
+#include "appletree/automaton.h"
+
+namespace appletree {
+
+// Glob syntax accepted by -e / -o:
+//   *       any run of characters except '/'
+//   ?       one character except '/'
+//   [...]   character class; [!...] or [^...] negates, a-z ranges
+//   **      as a whole path component: any number of components
+//   \c      the literal character c
+
+// True if 'pattern' uses any glob syntax
+bool isGlob(std::string_view pattern);
+
+// Adds 'pattern' to 'nfa' as pattern 'id'; it must match the whole input
+void addGlob(Nfa& nfa, std::string_view pattern, int id);
+
+} // namespace appletree
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace appletree {
+
+// Streaming XXH64 (same output as the reference xxHash XXH64). Fast enough
+// to hash at memory bandwidth; used for duplicate detection and content hashes.
+class Xxh64 {
+public:
+    explicit Xxh64(std::uint64_t seed = 0);
+
+    void update(const void* data, std::size_t len);
+    std::uint64_t digest() const;
+
+private:
+    std::uint64_t v_[4];
+    std::uint64_t seed_;
+    std::uint64_t total_ = 0;
+    unsigned char buf_[32];
+    std::size_t bufLen_ = 0;
+};
+
+// One-shot XXH64
+std::uint64_t xxh64(const void* data, std::size_t len, std::uint64_t seed = 0);
+
+// Hashes the whole content of the file at 'path' with large sequential
+// reads. 'size' receives the number of bytes hashed. False if it cannot be read.
+bool hashFile(const char* path, std::uint64_t& hash, std::uint64_t& size);
+
+// Hashes the first and last 'edge' bytes of a file of 'size' bytes (the whole
+// file if it is at most 2 * 'edge'). A cheap filter before hashFile().
+bool hashFileEdges(const char* path, std::uint64_t size, std::size_t edge, std::uint64_t& hash);
+
+// True if the files at 'a' and 'b' hold the same bytes, read side by side
+// in blocks. False if they differ or either cannot be read.
+bool sameContent(const char* a, const char* b);
+
+} // namespace appletree
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "appletree/automaton.h"
+
+namespace appletree {
+
+// Rules of one ignore file (.gitignore, .git/info/exclude, global excludes),
+// compiled into two DFAs whose pattern ids are the rule indices, so "last
+// matching rule wins" is a single max over the accepting patterns.
+class IgnoreRules {
+public:
+    enum class Match {none, ignored, included};
+
+    // Reads and compiles 'path'; false if it does not exist or has no rules
+    bool load(const std::filesystem::path& path);
+    // Compiles gitignore syntax from memory
+    void parse(std::string_view text);
+
+    bool empty() const { return rules_.empty(); }
+
+    // Decision for 'rel', relative to the directory of the ignore file
+    Match match(std::string_view rel, bool isDir) const;
+
+private:
+    struct Rule {
+        bool negate;
+        bool dirOnly;
+    };
+    std::vector<Rule> rules_;
+    Dfa all_;         // every rule, used for directories
+    Dfa filesOnly_;   // without 'dir/' rules, used for everything else
+};
+
+// Ignore rules in effect while walking: one frame per directory on the
+// current path, each holding that directory's parsed .gitignore. Deeper
+// frames take precedence, like in git.
+class IgnoreStack {
+public:
+    // Finds the enclosing repository of 'root' and loads the global excludes,
+    // .git/info/exclude and every .gitignore from the repository root down
+    // to 'root' (inclusive)
+    void init(const std::filesystem::path& root);
+
+    // Enters subdirectory 'dir' of the current top frame, loading its .gitignore
+    void push(const std::filesystem::path& dir);
+    void pop() { frames_.pop_back(); }
+
+    // True if entry 'name' in the current top directory is ignored
+    bool isIgnored(std::string_view name, bool isDir) const;
+
+private:
+    struct Frame {
+        std::string base;                            // relative to the repository root
+        std::shared_ptr<const IgnoreRules> rules;    // null if the directory has none
+    };
+    std::vector<Frame> frames_;
+    mutable std::string scratch_;
+};
+
+// Pushes a directory onto an IgnoreStack for the lifetime of the scope
+class IgnoreScope {
+public:
+    IgnoreScope(IgnoreStack* stack, const std::filesystem::path& dir) : stack_(stack) {
+        if (stack_) stack_->push(dir);
+    }
+    ~IgnoreScope() {
+        if (stack_) stack_->pop();
+    }
+    IgnoreScope(const IgnoreScope&) = delete;
+    IgnoreScope& operator=(const IgnoreScope&) = delete;
+
+private:
+    IgnoreStack* stack_;
+};
+
+} // namespace appletree
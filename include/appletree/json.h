@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "appletree/entry.h"
+#include "appletree/tree.h"
+#include "appletree/writer.h"
+
+namespace appletree {
+
+// Appends 's' as a quoted JSON string. Quotes, backslashes and control
+// characters are escaped and well-formed UTF-8 is copied through unchanged.
+// File names are bytes, not text: each byte that is not part of valid
+// UTF-8 becomes "\ufffd", so the output always parses (such names do not
+// round-trip). Runs of safe bytes are appended in bulk, no temporary
+// strings are built.
+void appendJsonString(std::string& out, std::string_view s);
+
+// Appends ',"files":N,"folders":N' (recursive counts of a folder, '--counts')
+void appendJsonCounts(std::string& out, std::uint64_t files, std::uint64_t folders);
+
+// Appends ',"newest":N' (newest mtime below a folder, '--age')
+void appendJsonNewest(std::string& out, std::int64_t newest);
+
+// Appends one NDJSON record terminated by '\n':
+// {"path":...,"type":...,"depth":N[,"size":N],"mtime":N[,"hash":"<16 hex>"][,"unscanned":true]<extra>}
+// 'extra' holds further members, each starting with ','.
+void appendNdjsonRecord(std::string& out, std::string_view path, EntryType type,
+                        std::size_t depth, std::optional<std::uintmax_t> size,
+                        std::int64_t mtime, std::optional<std::uint64_t> hash = std::nullopt,
+                        bool unscanned = false, std::string_view extra = {});
+
+// Writes 'root' as one nested JSON document in the layout of 'tree -J':
+// [{"type":"directory","name":...,"size":N,"contents":[...]}, {"type":"report",...}]
+// Single pass over the tree, straight into the writer's buffer. With
+// 'withCounts' folders also get "files" and "folders", with 'withNewest'
+// "newest".
+void writeJsonTree(OutputWriter& out, const Node& root, bool withCounts = false, bool withNewest = false);
+
+} // namespace appletree
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "appletree/pool.h"
+#include "appletree/tree.h"
+
+namespace appletree {
+
+// Content hashes from an earlier '--hash' snapshot, keyed on (device, inode,
+// size, mtime, ctime) with nanosecond times: a file that still matches all
+// of them is not read again. ctime also catches writes that restored the
+// mtime afterwards.
+class HashCache {
+public:
+    // Adds every hashed regular file of 'tree'
+    void add(const Node& tree);
+
+    // The stored hash of regular file 'file' if it is unchanged
+    bool find(const Node& file, std::uint64_t& hash) const;
+
+    std::size_t size() const { return map_.size(); }
+
+private:
+    struct Key {
+        std::uint64_t dev;
+        std::uint64_t ino;
+        std::uintmax_t size;
+        std::int64_t mtimeNs;
+        std::int64_t ctimeNs;
+        explicit Key(const Node& file)
+            : dev(file.dev), ino(file.ino), size(file.size.value_or(0)), mtimeNs(file.mtimeNs), ctimeNs(file.ctimeNs) {}
+        bool operator==(const Key& o) const {
+            return dev == o.dev && ino == o.ino && size == o.size && mtimeNs == o.mtimeNs && ctimeNs == o.ctimeNs;
+        }
+    };
+    struct KeyHash {
+        std::size_t operator()(const Key& k) const;
+    };
+    std::unordered_map<Key, std::uint64_t, KeyHash> map_;
+};
+
+struct HashStats {
+    std::size_t hashed = 0;       // files read
+    std::size_t cached = 0;       // files taken from the cache
+    std::size_t failed = 0;       // unreadable files (left without hash)
+};
+
+// Fills Node::hash for the whole tree below 'tree.path': regular files get
+// the XXH64 of their content (read on 'pool', one buffer per worker, unless
+// 'cache' knows them), links the hash of their target path, other entries
+// a hash of their type. Directories get a Merkle hash over their children's
+// (name, type, hash) in name order, so equal hashes mean equal subtrees.
+HashStats hashTree(Tree& tree, const HashCache& cache, ThreadPool& pool);
+
+} // namespace appletree
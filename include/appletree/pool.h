@@ -0,0 +1,44 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace appletree {
+
+// Fixed set of worker threads fed from one FIFO queue. Shared by everything
+// that runs in parallel in one process (batch scans, hashing, ...).
+class ThreadPool {
+public:
+    // 0 threads = one per hardware thread
+    explicit ThreadPool(std::size_t threads = 0);
+    // Finishes all queued tasks, then joins the workers
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+
+    // Blocks until the queue is empty and no task is running
+    void wait();
+
+    std::size_t size() const { return workers_.size(); }
+
+private:
+    void run();
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> queue_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::size_t running_ = 0;
+    bool stopping_ = false;
+};
+
+} // namespace appletree
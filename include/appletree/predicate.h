@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "appletree/filter.h"
+#include "appletree/tree.h"
+
+namespace appletree {
+
+// find-style predicates (--newer, --older-than, --min-size, --type, --ext).
+// They are evaluated on the lstat() data every scanned Node already carries,
+// so they never cost an extra syscall.
+struct Predicates {
+    std::optional<std::int64_t> newerThan;    // mtime strictly after (seconds)
+    std::optional<std::int64_t> olderThan;    // mtime strictly before (seconds)
+    std::optional<std::uintmax_t> minSize;    // regular files only
+    std::uint32_t types = 0;                  // bit per EntryType, 0 = any
+    LiteralSet extensions;                    // ".cpp", ".h"; non-directories only
+
+    bool empty() const {
+        return !newerThan && !olderThan && !minSize && types == 0 && extensions.empty();
+    }
+
+    // True if 'node' satisfies every predicate that is set
+    bool matches(const Node& node) const;
+};
+
+// "100M", "1.5G", "512k", "42" (bytes); binary multiples like the size output
+bool parseSizeArg(const std::string& s, std::uintmax_t& bytes);
+
+// "30s", "15m", "12h", "7d", "2w", "1y"; a plain number means days
+bool parseAgeArg(const std::string& s, std::int64_t& seconds);
+
+// Comma separated find(1) type letters: f d l p s b c
+bool parseTypeArg(const std::string& s, std::uint32_t& mask);
+
+// Comma separated extensions, with or without leading dot: "cpp,h" or ".cpp"
+void addExtensions(const std::string& s, LiteralSet& extensions);
+
+} // namespace appletree
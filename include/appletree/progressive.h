@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "appletree/pool.h"
+#include "appletree/render.h"
+#include "appletree/scan.h"
+#include "appletree/writer.h"
+
+namespace appletree {
+
+// Tree output for '-s --progressive': lines are written as soon as they are
+// listed while folder sizes are summed on a worker pool. Once a folder's
+// listing is complete, a worker sums what it holds apart from the listed
+// subfolders; their sizes are added in as they arrive, so every directory is
+// read once, by the same rules as 'scanner' (.gitignore). On a terminal every
+// folder line is redrawn in place once its size is known; sizes of lines that
+// scrolled out of view, or all of them when the output is not a terminal,
+// follow in a trailing section. Use with ScanOptions::deferDirSizes.
+class ProgressiveRenderer : public Renderer {
+public:
+    ProgressiveRenderer(OutputWriter& out, const RenderOptions& options, const Scanner& scanner,
+                        const std::filesystem::path& root, bool terminal);
+    ~ProgressiveRenderer() override;
+
+    void entry(const EntryView& entry, std::size_t depth, bool isLast) override;
+
+    // Waits for the outstanding sizes and writes the ones not shown yet
+    void finish();
+
+private:
+    static constexpr std::size_t kNoParent = static_cast<std::size_t>(-1);
+
+    // A folder line waiting for its size
+    struct Folder {
+        std::size_t line;         // 0-based output line
+        std::string head;         // the line without size suffix and '\n'
+        std::string path;         // relative to the root
+        std::filesystem::path dir;
+        std::size_t depth;
+        std::size_t parent;       // folder its size is added to, or kNoParent
+        std::vector<std::string> listed;  // subfolders that add their own size
+        std::size_t pending = 1;  // own sum and listed subfolders still missing
+        std::uintmax_t size = 0;
+        bool shown = false;       // redrawn in place
+    };
+
+    void close(std::size_t depth);
+    void add(std::size_t id, std::uintmax_t size);
+    void apply(bool wait);
+    void redraw(Folder& folder);
+
+    OutputWriter& out_;
+    OutputWriter lines_{-1};
+    std::unique_ptr<Renderer> text_;
+    const Scanner& scanner_;
+    std::filesystem::path root_;
+    bool terminal_;
+    bool color_;
+    std::string_view noSize_;     // how text_ ends the line of a folder without a size
+    std::size_t rows_ = 24;
+    std::size_t lineCount_ = 0;
+    std::vector<Folder> folders_;
+    std::vector<std::size_t> open_;   // folders whose listing is still going on
+    bool finished_ = false;
+    std::chrono::steady_clock::time_point lastFlush_;
+
+    // Written by the workers
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::vector<std::pair<std::size_t, std::uintmax_t>> done_;
+    std::size_t outstanding_ = 0;
+
+    // Last member: joined before anything the workers touch goes away
+    ThreadPool pool_;
+};
+
+} // namespace appletree
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "appletree/automaton.h"
+
+namespace appletree {
+
+// Regex dialect for --exclude-re / --only-re (searched anywhere in the
+// relative path unless anchored):
+//   .  [...]  [^...]  [[:alpha:]] (and the other POSIX classes, ASCII only)
+//   \d \w \s \D \W \S  \n \t \r \f \v  \c (c not a letter or digit: literal)
+// Other escapes of letters or digits (\b, \1, ...) and [=e=] / [.ch.]
+// are rejected when the pattern is compiled.
+//   ( )  (?: )  |  *  +  ?  {n}  {n,}  {n,m}  (lazy '?' suffixes are accepted)
+//   ^ and $ only at the start / end of a top-level alternative
+// There are no backreferences or lookarounds: every pattern compiles to an
+// NFA, so matching runs through the shared DFA in linear time.
+
+// Adds 'pattern' to 'nfa' as pattern 'id' (full-match form, with implicit
+// '.*' on unanchored sides). Returns false and sets 'error' if the pattern
+// is invalid or too large.
+bool addRegex(Nfa& nfa, std::string_view pattern, int id, std::string& error);
+
+// All regexes of one option, combined into a single DFA
+class RegexFilter {
+public:
+    bool add(const std::string& pattern, std::string& error);
+    void compile();   // after the last add()
+
+    bool empty() const { return dfa_.empty(); }
+
+    // Some regex matches 'rel'
+    bool matches(std::string_view rel) const { return dfa_.run(rel).acceptEnd >= 0; }
+
+    // For --only-re: match if 'rel' matches, below if it is a directory that
+    // could contain a match
+    OnlyMatch keeps(std::string_view rel, bool isDir) const {
+        DfaRun r = dfa_.run(rel);
+        if (r.acceptEnd >= 0) return OnlyMatch::match;
+        return isDir && r.liveBelow ? OnlyMatch::below : OnlyMatch::none;
+    }
+
+private:
+    Nfa nfa_;
+    int count_ = 0;
+    Dfa dfa_;
+};
+
+} // namespace appletree
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "appletree/entry.h"
+
+#include "appletree/tree.h"
+#include "appletree/writer.h"
+
+namespace appletree {
+
+// ANSI terminal output styles
+constexpr char kReset[] = "\033[0m";
+constexpr char kBold[] = "\033[1m";
+constexpr char kFgGray[] = "\033[37m";
+constexpr char kFgRed[] = "\033[31m";
+constexpr char kFgGreen[] = "\033[32m";
+constexpr char kFgYellow[] = "\033[33m";
+constexpr char kFgCyan[] = "\033[36m";
+constexpr char kFgBlue[] = "\033[34m";
+
+// 'code' when ANSI styles are on ('--color'), otherwise nothing
+inline const char* ansi(bool color, const char* code) { return color ? code : ""; }
+
+// Theme/Format
+enum class Theme {classic, round};
+
+// Output format ('--format')
+enum class Format {tree, ndjson, json, bin};
+
+// Connector in front of an entry ("├── ", "└── ", "╰── ")
+const char* branch(Theme theme, bool isLast);
+
+// Indentation continued below an entry ("│   " or blanks)
+const char* vertical(Theme theme, bool isLast);
+
+// The helpers below draw with ANSI styles unless 'color' is false
+
+// Appends " [<hash>]" in gray
+void appendHashSuffix(std::string& out, std::uint64_t hash, bool color = true);
+
+// Appends " (<size>)" in gray, nothing if 'size' is empty
+void appendSizeSuffix(std::string& out, std::optional<std::uintmax_t> size, bool color = true);
+
+// What a tree line shows next to the size ('--counts', '--age')
+struct LineDetails {
+    bool counts = false;
+    std::uint64_t files = 0;
+    std::uint64_t folders = 0;
+    std::optional<std::int64_t> age;    // seconds since the newest modification
+};
+
+// Appends " (<size>, <n> files, <n> folders, <age> ago)" in gray; each part
+// only if set
+void appendDetailsSuffix(std::string& out, std::optional<std::uintmax_t> size, const LineDetails& details,
+                         bool color = true);
+
+// Color of an age bucket ('--age-color'): red below a day, then yellow
+// (week), green (90 days), cyan (year) and blue
+const char* ageColor(std::int64_t seconds);
+
+// Appends the start of a tree line (" <prefix><branch><name>[/]"), without
+// suffixes or newline. A 'nameColor' is put in front of the name.
+void appendTreeName(std::string& out, const std::string& prefix, bool isLast,
+                    std::string_view name, bool isDir, Theme theme, const char* nameColor = nullptr,
+                    bool color = true);
+
+// Appends one rendered tree line (" <prefix><branch><name>[/] (<size>)\n") to 'out'
+void appendTreeLine(std::string& out, const std::string& prefix, bool isLast,
+                    std::string_view name, bool isDir, std::optional<std::uintmax_t> size,
+                    Theme theme, bool color = true);
+
+// How a scan is written out
+struct RenderOptions {
+    Format format = Format::tree;
+    Theme theme = Theme::classic;
+    bool sizes = false;           // draw sizes in the tree format
+    bool counts = false;          // file and folder counts of every folder ('--counts')
+    bool age = false;             // age of the newest modification below each entry ('--age')
+    bool ageColor = false;        // names colored by that age ('--age-color')
+    bool color = true;            // ANSI styles in the tree format ('--color')
+};
+
+// One entry as handed to a Renderer; the views are only valid during the call
+struct EntryView {
+    std::string_view name;
+    std::string_view path;        // relative to the root, "." for the root itself
+    EntryType type = EntryType::other;
+    bool isDir = false;
+    std::optional<std::uintmax_t> size;
+    std::int64_t mtime = 0;
+    std::uint64_t dev = 0;        // with hash: the file's identity, see Node
+    std::uint64_t ino = 0;
+    std::int64_t mtimeNs = 0;
+    std::int64_t ctimeNs = 0;
+    std::optional<std::uint64_t> hash;
+    std::uint64_t files = 0;      // folders, with sizes: files and folders below
+    std::uint64_t folders = 0;
+    std::int64_t newest = 0;      // folders, with sizes: newest mtime in the subtree
+    bool unscanned = false;
+};
+
+// Writes entries in one output format. Scanner::stream() calls entry()
+// while walking; render() replays a finished Tree through the same calls.
+class Renderer {
+public:
+    virtual ~Renderer() = default;
+
+    // Called for the root (depth 0), then for every entry in display order.
+    // 'isLast' marks the last child of its parent.
+    virtual void entry(const EntryView& entry, std::size_t depth, bool isLast) = 0;
+
+    // Nested formats (JSON) can only be written from a complete tree
+    virtual bool needsTree() const { return false; }
+
+    virtual void render(const Tree& tree);
+};
+
+// Renderer for 'options.format' writing to 'out'
+std::unique_ptr<Renderer> makeRenderer(OutputWriter& out, const RenderOptions& options);
+
+} // namespace appletree
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "appletree/filter.h"
+#include "appletree/predicate.h"
+#include "appletree/regex.h"
+#include "appletree/sortkey.h"
+#include "appletree/tree.h"
+
+namespace appletree {
+
+class Renderer;
+class ScanBudget;
+
+// Recursive sum of the regular file sizes below 'dir', unfiltered (what
+// '-s' shows for a folder)
+std::uintmax_t dirSizeRecursive(const std::filesystem::path& dir);
+
+// What to scan: filters, predicates, depth limit and whether directory
+// sizes are needed. Fill it in, call compile() once, then share it between
+// as many scans (and threads) as needed; scans only read it.
+struct ScanOptions {
+    ExcludeFilter exclude;        // '-e' patterns
+    OnlyFilter only;              // '-o' patterns
+    RegexFilter excludeRegex;     // '--exclude-re'
+    RegexFilter onlyRegex;        // '--only-re'
+    Predicates predicates;        // '--newer', '--min-size', ...
+    bool gitignore = false;       // honor .gitignore files
+    std::optional<std::size_t> maxDepth;  // nullopt meaning unlimited
+    bool sizes = false;           // sizes for directories (and link targets); a folder counts
+                                  // every file below it, filtered out or not, apart
+                                  // from what 'gitignore' leaves out
+    bool deferDirSizes = false;   // stream(): leave folder sizes to the renderer
+    ScanBudget* budget = nullptr; // '--timeout' / '--max-entries-total', shared by all scans
+    bool breadthFirst = false;    // scan(): read level by level in parallel ('--bfs')
+    std::size_t levelThreads = 0; // workers of one breadth-first scan; 0 = one per hardware thread
+    SortOrder sort = SortOrder::name;   // order of the entries of a folder ('--sort')
+
+    // Compiles all patterns; call after the last add()
+    void compile();
+};
+
+// Walks directory trees according to a ScanOptions (kept as a copy). Every
+// call keeps its traversal state (gitignore stack, ...) on its own stack
+// frame, so one Scanner can run on several threads at once.
+class Scanner {
+public:
+    explicit Scanner(ScanOptions options) : options_(std::move(options)) {}
+
+    // Builds the filtered tree below 'root'. With 'sizes' directory sizes
+    // are summed bottom-up from the listed entries. With 'breadthFirst' the
+    // folders of each depth are read in parallel before the next depth.
+    Tree scan(const std::filesystem::path& root) const;
+
+    // Hands every entry to 'renderer' as soon as it is listed, without
+    // keeping the tree. Falls back to scan() + render() when the renderer
+    // or the predicates need the whole tree first, or when a budget may
+    // leave folders unscanned (known only after they were drawn) or the
+    // scan is breadth-first.
+    void stream(const std::filesystem::path& root, Renderer& renderer) const;
+
+    // The filtered, sorted direct children of 'dir' (a folder below 'root'),
+    // without descending. For callers that expand the tree lazily.
+    std::vector<Node> list(const std::filesystem::path& root, const std::filesystem::path& dir) const;
+
+    // What '-s' counts for 'dir' (a folder below 'root') apart from its
+    // subfolders named in 'except' (sorted), which the caller sums itself.
+    // With 'folders', every folder counted is added to its children, with
+    // its size and its own subfolders, so a whole subtree is sized in one
+    // walk. For callers that size folders lazily.
+    std::uintmax_t size(const std::filesystem::path& root, const std::filesystem::path& dir,
+                        const std::vector<std::string>& except = {}, Node* folders = nullptr) const;
+
+private:
+    ScanOptions options_;
+};
+
+} // namespace appletree
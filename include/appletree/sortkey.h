@@ -0,0 +1,41 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace appletree {
+
+// Order of the entries of a folder ('--sort')
+enum class SortOrder {
+    name,       // byte order of the names (default)
+    natural,    // digit runs by numeric value: "shard-2" < "shard-10"
+    locale,     // collation of LC_COLLATE (strxfrm)
+};
+
+// Appends the sort key of 'name' to 'key'. Keys compare byte-wise (as
+// std::string does) in 'order'; names that collate equal are ordered by
+// their bytes, so no two names share a key.
+void appendSortKey(std::string& key, std::string_view name, SortOrder order);
+
+// Sorts 'items' by 'name(item)' in 'order' (not SortOrder::name). Every key
+// is computed once up front, the comparisons are plain byte compares.
+template <class T, class NameOf>
+void sortByKey(std::vector<T>& items, SortOrder order, NameOf name) {
+    std::vector<std::pair<std::string, std::size_t>> keys(items.size());
+    for (std::size_t i = 0; i < items.size(); ++i) {
+        appendSortKey(keys[i].first, name(items[i]), order);
+        keys[i].second = i;
+    }
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<T> sorted;
+    sorted.reserve(items.size());
+    for (auto& key : keys) sorted.push_back(std::move(items[key.second]));
+    items = std::move(sorted);
+}
+
+} // namespace appletree
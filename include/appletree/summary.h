@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "appletree/entry.h"
+#include "appletree/render.h"
+
+namespace appletree {
+
+// Histogram of the scanned entries by file type and by extension
+// ('--summary'): count and bytes per bucket. Filled entry by entry while
+// the tree is walked, so it costs no second pass. Extensions go into a
+// small open-addressing table (linear probing, power-of-two capacity).
+class Summary {
+public:
+    Summary();
+
+    void add(const EntryView& entry);
+
+    // " Summary:" section with one aligned table per histogram; ANSI styles
+    // only with 'color'
+    void writeText(std::string& out, bool color) const;
+    // {"summary":"type"|"extension","key":...,"count":N,"bytes":N} per bucket
+    void writeNdjson(std::string& out) const;
+
+private:
+    struct Bucket {
+        std::string key;          // extension including the dot, "" = none
+        std::uint64_t count = 0;
+        std::uint64_t bytes = 0;
+        bool used = false;
+    };
+
+    Bucket& extension(std::string_view key);
+    void grow();
+    // Used buckets, most bytes first
+    std::vector<const Bucket*> sortedExtensions() const;
+
+    std::vector<Bucket> slots_;
+    std::size_t used_ = 0;
+    std::array<Bucket, 8> types_;     // indexed by EntryType
+};
+
+// Feeds every entry into 'summary' and passes it on to 'inner' (null: only
+// the summary is wanted)
+class SummaryRenderer : public Renderer {
+public:
+    SummaryRenderer(Renderer* inner, Summary& summary) : inner_(inner), summary_(summary) {}
+
+    void entry(const EntryView& entry, std::size_t depth, bool isLast) override {
+        summary_.add(entry);
+        if (inner_) inner_->entry(entry, depth, isLast);
+    }
+    bool needsTree() const override { return inner_ && inner_->needsTree(); }
+
+private:
+    Renderer* inner_;
+    Summary& summary_;
+};
+
+} // namespace appletree
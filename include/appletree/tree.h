@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "appletree/entry.h"
+
+namespace appletree {
+
+// One entry of an in-memory scan. Directory sizes are aggregated bottom-up
+// from their children while scanning.
+struct Node {
+    std::string name;
+    EntryType type = EntryType::other;
+    bool isDir = false;                   // descended into (directories and links to them)
+    std::optional<std::uintmax_t> size;   // files always, directories with '-s'
+    std::int64_t mtime = 0;
+    std::uint64_t dev = 0;                // dev, ino and the nanosecond times identify an
+    std::uint64_t ino = 0;                // unchanged file for '--hash-cache'
+    std::int64_t mtimeNs = 0;
+    std::int64_t ctimeNs = 0;
+    std::optional<std::uint64_t> hash;    // content (files) or Merkle (directories) hash with '--hash'
+    std::uint64_t digest = 0;             // fingerprint of the subtree's metadata, once aggregated
+    std::uint64_t files = 0;              // with sizes, folders: files in the subtree
+    std::uint64_t folders = 0;            // with sizes, folders: folders in the subtree
+    std::int64_t newest = 0;              // with sizes, folders: newest mtime in the subtree (itself included)
+    bool unscanned = false;               // folder not (completely) read: the scan budget ran out
+    bool onlyBelow = false;               // kept by -o/--only-re only in case a match lies inside
+    std::vector<Node> children;           // sorted by name (or in the '--sort' order)
+};
+
+// Result of a scan: the root entry (named after the scanned directory) and
+// the path it was read from
+struct Tree {
+    std::filesystem::path path;
+    Node root;
+};
+
+} // namespace appletree
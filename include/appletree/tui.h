@@ -0,0 +1,17 @@
+#pragma once
+
+#include <filesystem>
+
+#include "appletree/render.h"
+#include "appletree/scan.h"
+
+namespace appletree {
+
+// Interactive tree browser ('-i'). Only the root is listed up front; a
+// folder is read when it is first expanded. Folder sizes are computed on a
+// worker pool in the background, one walk per top-level folder that keeps
+// the sizes of every folder below it, and appear as they finish. Needs a terminal
+// on stdin and stdout; returns the process exit code.
+int runInteractive(const std::filesystem::path& root, const ScanOptions& options, Theme theme);
+
+} // namespace appletree
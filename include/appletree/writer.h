@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace appletree {
+
+// Buffered writer on top of a raw file descriptor. Renderers append to
+// buffer() and call commit(); the data is written once the buffer is full,
+// so output costs one write() per ~64 KiB instead of one per line.
+// With fd -1 nothing is written: buffer() collects the complete output
+// (used to render concurrent scans into separate sections).
+class OutputWriter {
+public:
+    explicit OutputWriter(int fd = 1, std::size_t capacity = 1 << 16);
+    ~OutputWriter();
+
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+
+    std::string& buffer() { return buf_; }
+
+    // Flushes if the buffer reached its capacity
+    void commit() {
+        if (fd_ >= 0 && buf_.size() >= capacity_) flush();
+    }
+
+    // Writes everything buffered so far
+    void flush();
+
+    // False once a write() failed (e.g. closed pipe)
+    bool ok() const { return !failed_; }
+
+private:
+    int fd_;
+    std::size_t capacity_;
+    std::string buf_;
+    bool failed_ = false;
+};
+
+} // namespace appletree
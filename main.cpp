@@ -1,111 +1,142 @@
 #include <iostream>
+#include <fstream>
 #include <filesystem>
 #include <string>
 #include <vector>
-#include <unordered_set>
-#include <optional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 #include <algorithm>
+#include <chrono>
+#include <optional>
 #include <cctype>
-#include <system_error>
-
-// Macros for ANSI terminal output style
-#define RESET   "\033[0m"
-#define BOLD    "\033[1m"
-#define FG_GRAY "\033[37m"
+#include <clocale>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "appletree/binfmt.h"
+#include "appletree/budget.h"
+#include "appletree/diff.h"
+#include "appletree/dupes.h"
+#include "appletree/json.h"
+#include "appletree/merkle.h"
+#include "appletree/pool.h"
+#include "appletree/predicate.h"
+#include "appletree/progressive.h"
+#include "appletree/render.h"
+#include "appletree/scan.h"
+#include "appletree/summary.h"
+#include "appletree/tui.h"
+#include "appletree/writer.h"
 
 namespace fs = std::filesystem;
-
-// Filter for flags/options
-std::unordered_set<std::string> excludeList;  // List for '-e'-flag
-std::unordered_set<std::string> onlyList;     // List for '-o'-flag
-
-// Depth limit (nullopt meaning unlimited)
-std::optional<size_t> maxDepth;
-
-// Show sizes
-bool showSizes = false;
-
-// Theme/Format
-enum class Theme {classic, round};
-Theme currentTheme = Theme::classic; // Default theme
-
-// Helper Functions
-std::string branch(bool isLast) {
-    if (currentTheme == Theme::round) {
-        return isLast ? "╰── " : "├── ";
-    } else {
-        return isLast ? "└── " : "├── ";
-    }
-}
-
-std::string vertical(bool isLast) {
-    if (currentTheme == Theme::round) {
-        return isLast ? "    " : "│   ";
-    } else {
-        return isLast ? "    " : "│   ";
-    }
-}
-
-std::pair<bool, std::uintmax_t> fileSizeSafe(const fs::path& p) {
-    std::error_code ec;
-    if (!fs::is_regular_file(p, ec) || ec) return {false, 0};
-    auto s = fs::file_size(p, ec);
-    if (ec) return {false, 0};
-    return {true, s};
-}
-
-std::uintmax_t dirSizeRecursive(const fs::path& dir) {
-    std::uintmax_t total = 0;
-    std::error_code ec;
-    for (auto& entry : fs::recursive_directory_iterator(dir, fs::directory_options::skip_permission_denied, ec)) {
-        if (fs::is_regular_file(entry.path(), ec)) {
-            auto s = fs::file_size(entry.path(), ec);
-            if (!ec) total += s;
-        }
-    }
-
-    return total;
-}
-
-std::string formatSize(std::uintmax_t bytes) {
-    static const char* units[] = {"B","KiB","MiB","GiB","TiB","PiB","EiB"};
-    double value = static_cast<double>(bytes);
-    int idx = 0;
-    while (value >= 1024.0 && idx < 6) {
-        value /= 1024.0;
-        ++idx;
-    }
-
-    char buf[32];
-    if (value < 10.0 && idx > 0) {
-        std::snprintf(buf, sizeof(buf), "%.1f %s", value, units[idx]);
-    } else {
-        std::snprintf(buf, sizeof(buf), "%.0f %s", value, units[idx]);
-    }
-
-    return std::string(buf);
-}
+using namespace appletree;
 
 // Help function
 void showHelp() {
     std::cout << "\n";
-    std::cout << " " << BOLD << "✨ appletree – Directory Tree Viewer ✨" << RESET << "\n\n";
-    std::cout << BOLD << " Usage:" << RESET << "\n";
+    std::cout << " " << kBold << "✨ appletree – Directory Tree Viewer ✨" << kReset << "\n\n";
+    std::cout << kBold << " Usage:" << kReset << "\n";
     std::cout << "   appletree [path] [options]\n\n";
 
-    std::cout << BOLD << " Options:" << RESET << "\n";
+    std::cout << kBold << " Options:" << kReset << "\n";
     std::cout << "   -e <pattern>     Exclude files or directories from the output.\n";
     std::cout << "                      • If <pattern> is just a name (e.g. 'node_modules'),\n";
     std::cout << "                        all entries with that basename are excluded anywhere.\n";
     std::cout << "                      • If <pattern> contains '/' (e.g. 'src/main.cpp'),\n";
     std::cout << "                        only that relative path (or subtree) is excluded.\n";
-    std::cout << "                      • Use '.' to exclude hidden files/dirs.\n\n";
+    std::cout << "                      • Use '.' to exclude hidden files/dirs.\n";
+    std::cout << "                      • Globs: '*.o', 'build-*', '**/target', 'src/*/gen'\n";
+    std::cout << "                        (* and ? stop at '/', ** spans directories; quote them).\n\n";
 
     std::cout << "   -o <pattern>     Show only the specified files or directories.\n";
     std::cout << "                      • Works like -e, but in reverse: restricts output to\n";
     std::cout << "                        matching paths and their subtrees.\n";
     std::cout << "                      • Parent folders are shown automatically so you can\n";
-    std::cout << "                        navigate to deep matches.\n\n";
+    std::cout << "                        navigate to deep matches.\n";
+    std::cout << "                      • Globs are matched against the relative path;\n";
+    std::cout << "                        use '**/name' to match a name at any depth.\n\n";
+
+    std::cout << "   --gitignore      Skip everything git would ignore.\n";
+    std::cout << "                      • Reads .gitignore files, .git/info/exclude and the\n";
+    std::cout << "                        global excludes file; '.git' itself is hidden.\n";
+    std::cout << "                      • Ignored folders are never opened and do not count\n";
+    std::cout << "                        toward -s folder sizes.\n\n";
+
+    std::cout << "   --exclude-re <regex>  Exclude entries whose relative path matches.\n";
+    std::cout << "   --only-re <regex>     Show only matching entries (and folders that may\n";
+    std::cout << "                         contain matches).\n";
+    std::cout << "                      • Regexes search the path unless anchored with ^ / $.\n";
+    std::cout << "                      • All regexes run together through one DFA: linear\n";
+    std::cout << "                        time, no backtracking, no backreferences.\n";
+    std::cout << "                      • \\d \\w \\s and [[:alpha:]]-style classes work; other\n";
+    std::cout << "                        escapes of letters (\\b, \\A, ...) are an error.\n\n";
+
+    std::cout << "   --newer <file>        Show entries modified after <file>.\n";
+    std::cout << "   --older-than <age>    Show entries older than <age> ('30m', '12h', '7d', '2w').\n";
+    std::cout << "   --min-size <size>     Show files of at least <size> ('512K', '100M', '2G').\n";
+    std::cout << "   --type <f|d|l|...>    Show only files, directories, links (comma separated).\n";
+    std::cout << "   --ext <list>          Show only files with these extensions ('cpp,h').\n";
+    std::cout << "                      • Predicates combine with AND and use the data the\n";
+    std::cout << "                        scan already has; parent folders of matches are kept.\n";
+    std::cout << "                      • With -d only entries within the depth are tested.\n\n";
+
+    std::cout << "   --roots-from <file>   Scan every path listed in <file> ('-' = stdin).\n";
+    std::cout << "                      • Roots are scanned in parallel on a thread pool.\n";
+    std::cout << "                      • Each result gets its own section ('==> path <=='\n";
+    std::cout << "                        or a {\"root\": ...} line with ndjson), in list order.\n\n";
+
+    std::cout << "   --dupes          Find files with identical content.\n";
+    std::cout << "                      • Compared by size, then the first and last 4 KiB,\n";
+    std::cout << "                        then a full hash, then byte by byte, in parallel;\n";
+    std::cout << "                        empty files are skipped.\n";
+    std::cout << "                      • Shows duplicates as 'name [#group]' and each folder\n";
+    std::cout << "                        with the bytes wasted by extra copies below it\n";
+    std::cout << "                        (the first path of a group counts as the original).\n";
+    std::cout << "                      • '--format ndjson' prints one line per group.\n\n";
+
+    std::cout << "   --hash           Show a content hash for every file and a Merkle hash\n";
+    std::cout << "                    for every folder (same hash = same subtree).\n";
+    std::cout << "   --hash-cache <file>   Like --hash, reusing the hashes stored in <file>\n";
+    std::cout << "                         for unchanged files (same device, inode, size,\n";
+    std::cout << "                         mtime and ctime, to the nanosecond),\n";
+    std::cout << "                         then saving the new snapshot there.\n";
+    std::cout << "                      • Files are read in parallel; the snapshot is a\n";
+    std::cout << "                        '--format bin' stream and works with '--diff'.\n";
+    std::cout << "                      • Not with -d, --timeout or --max-entries-total: a folder\n";
+    std::cout << "                        hash needs the complete subtree.\n\n";
+
+    std::cout << "   --diff <A> <B>   Show what changed from A to B.\n";
+    std::cout << "                      • A and B are directories or snapshots saved with\n";
+    std::cout << "                        '--format bin'; contents are never read.\n";
+    std::cout << "                      • '+' added, '-' removed, '~' size changed,\n";
+    std::cout << "                        '*' modification time changed.\n";
+    std::cout << "                      • Folders with the same total size and newest mtime\n";
+    std::cout << "                        are treated as identical and skipped.\n\n";
+
+    std::cout << "   --timeout <time>           Stop reading after <time> ('500ms', '5s', '2m').\n";
+    std::cout << "   --max-entries-total <n>    Stop reading after <n> directory entries.\n";
+    std::cout << "                      • The budget is shared by all scans of the run\n";
+    std::cout << "                        (e.g. every root of '--roots-from').\n";
+    std::cout << "                      • What was read is shown; folders that were not\n";
+    std::cout << "                        (completely) read are marked '(not scanned)'.\n";
+    std::cout << "                      • With --timeout a read stuck on a slow mount is\n";
+    std::cout << "                        abandoned at the deadline.\n\n";
+
+    std::cout << "   --bfs            Read the tree breadth-first: all folders of one level\n";
+    std::cout << "                    in parallel, then the next level.\n";
+    std::cout << "                      • With -d no folder below the limit is opened.\n";
+    std::cout << "                      • With a budget the tree is complete to some depth\n";
+    std::cout << "                        instead of one deep branch.\n\n";
+
+    std::cout << "   -i               Browse the tree interactively.\n";
+    std::cout << "                      • Folders are only read when you open them; their\n";
+    std::cout << "                        sizes are computed in the background.\n";
+    std::cout << "                      • Keys: ↑/↓ (j/k) move, → (enter, l) open,\n";
+    std::cout << "                        ← (h) close or go to parent, space toggle, q quit.\n\n";
 
     std::cout << "   -d <number>      Limit recursion depth.\n";
     std::cout << "                      • 0 = only show the root directory name.\n";
@@ -115,136 +146,105 @@ void showHelp() {
 
     std::cout << "   -s               Show file and directory sizes.\n";
     std::cout << "                      • Regular files: actual file size.\n";
-    std::cout << "                      • Directories: recursive sum of contained file sizes.\n";
+    std::cout << "                      • Directories: recursive sum of contained file sizes,\n";
+    std::cout << "                        including files hidden by -e/-o/--only-re/predicates\n";
+    std::cout << "                        (but not the ones --gitignore skips).\n";
     std::cout << "                      • Note: This may differ from 'du', which reports on-disk blocks.\n\n";
 
+    std::cout << "   --progressive    Like -s, but print the tree at once and fill in folder\n";
+    std::cout << "                    sizes as they are computed in the background.\n";
+    std::cout << "                      • On a terminal the lines are updated in place.\n";
+    std::cout << "                      • Otherwise the sizes follow in a 'Folder sizes:' section.\n\n";
+
+    std::cout << "   --summary        After the tree, show count and bytes per file type and\n";
+    std::cout << "                    per extension (largest first).\n";
+    std::cout << "   --summary-only   The same, without the tree.\n";
+    std::cout << "                      • Collected while the tree is walked; filters and -d apply.\n";
+    std::cout << "                      • '--format ndjson' adds one {\"summary\": ...} line per row.\n\n";
+
+    std::cout << "   --counts         Show how many files and folders each folder holds.\n";
+    std::cout << "                      • e.g. 'src/ (1.2 GiB, 48,213 files, 312 folders)' with -s.\n";
+    std::cout << "                      • Counted in the same walk as the sizes (same rules:\n";
+    std::cout << "                        everything below the folder, links to folders not\n";
+    std::cout << "                        followed); also in ndjson/json output.\n\n";
+
+    std::cout << "   --age            Show how long ago each entry changed; for a folder, the\n";
+    std::cout << "                    newest modification anywhere below it.\n";
+    std::cout << "   --age-color      The same, and color names by age: red < 1 day, yellow < 1\n";
+    std::cout << "                    week, green < 90 days, cyan < 1 year, blue older.\n";
+    std::cout << "                      • Taken from the stats of the size walk (like --counts).\n";
+    std::cout << "                      • ndjson/json output gets \"newest\" (Unix time) per folder.\n\n";
+
+    std::cout << "   --sort <order>   Order of the entries of each folder.\n";
+    std::cout << "                      • 'name' (default): byte order of the names.\n";
+    std::cout << "                      • 'natural': numbers by value (shard-2 before shard-10).\n";
+    std::cout << "                      • 'locale': the collation order of your locale (LC_COLLATE).\n";
+    std::cout << "                      • Not with --diff, --hash or '--format bin', which rely on\n";
+    std::cout << "                        name order.\n\n";
+
     std::cout << "   -t <theme>       Change the drawing theme of the tree.\n";
     std::cout << "                      • 'classic' (default): ├── └── │\n";
     std::cout << "                      • 'round':             ├── ╰── │ (rounded corners)\n\n";
 
-    std::cout << BOLD << " Examples:" << RESET << "\n";
+    std::cout << "   --format <fmt>   Choose the output format.\n";
+    std::cout << "                      • 'tree' (default): the drawn tree.\n";
+    std::cout << "                      • 'ndjson': one JSON object per line and entry with\n";
+    std::cout << "                        path, type, depth, size and mtime, streamed while scanning.\n";
+    std::cout << "                      • 'json': one nested document like 'tree -J'.\n";
+    std::cout << "                      • 'bin': compact little-endian record stream\n";
+    std::cout << "                        (see include/appletree/binfmt.h for layout and reader).\n\n";
+
+    std::cout << "   -O <file>        Write the output to <file> instead of stdout.\n";
+    std::cout << "                      • Written in 64 KiB blocks straight to the file.\n\n";
+
+    std::cout << "   --color <when>   Use ANSI colors and bold text.\n";
+    std::cout << "                      • 'auto' (default): only if the output is a terminal.\n";
+    std::cout << "                      • 'always' / 'never': regardless of the output.\n\n";
+
+    std::cout << kBold << " Examples:" << kReset << "\n";
     std::cout << "   appletree                        Show the tree of the current directory\n";
     std::cout << "   appletree /path/to/folder        Show the tree of the specified directory\n";
     std::cout << "   appletree -e node_modules        Exclude all 'node_modules' folders\n";
     std::cout << "   appletree -e src/main.cpp        Exclude only 'src/main.cpp'\n";
+    std::cout << "   appletree -e '*.o' '**/target'   Exclude object files and all 'target' folders\n";
     std::cout << "   appletree -o src                 Show only the 'src' subtree\n";
     std::cout << "   appletree -o src/util/log.h      Show only that single file and its parents\n";
     std::cout << "   appletree -e . -d 2              Exclude hidden files and limit depth to 2\n";
     std::cout << "   appletree -s                     Show file & folder sizes\n";
-    std::cout << "   appletree -t round               Use round corners for the tree\n\n";
+    std::cout << "   appletree -t round               Use round corners for the tree\n";
+    std::cout << "   appletree --format ndjson        Stream entries as NDJSON for other tools\n";
+    std::cout << "   appletree --min-size 100M -s     Find large files and where they live\n";
+    std::cout << "   appletree --ext cpp,h --older-than 1y  Find stale sources\n\n";
 
-    std::cout << BOLD << " Notes:" << RESET << "\n";
+    std::cout << kBold << " Notes:" << kReset << "\n";
     std::cout << " • Multiple -e or -o patterns can be given in sequence.\n";
     std::cout << " • Excludes take precedence over includes.\n";
     std::cout << " • Hidden files: use -e . to skip them globally.\n\n";
 
     std::cout << " For more details, visit:\n";
-    std::cout << "   " << BOLD << "https://github.com/mattialosz/appletree" << RESET << "\n\n";
-    std::cout << " \033[47;30m Created by @mattialoszach " << RESET << "\n";
+    std::cout << "   " << kBold << "https://github.com/mattialosz/appletree" << kReset << "\n\n";
+    std::cout << " \033[47;30m Created by @mattialoszach " << kReset << "\n";
 }
 
-// Function to display the directory as a tree structure with filter options
-void printTree(const fs::path& root, const fs::path& current, const std::string& prefix = "", size_t depth = 0) {
-    // Respect depth limit: if maxDepth is set and we've reached it, stop recursion
-    if (maxDepth.has_value() && depth >= maxDepth.value()) {
-        return;
-    }
-
-    std::vector<fs::path> entries;
-
-    // Collect all files & folders within the root directory
-    std::error_code ec;
-    for (fs::directory_iterator it(current, fs::directory_options::skip_permission_denied, ec);
-         !ec && it != fs::directory_iterator(); it.increment(ec)) {
-
-        const auto& entry = *it;
-        const std::string filename = entry.path().filename().string();
-
-        // Hidden via "-e ."
-        if (!filename.empty() && excludeList.count(".") && filename[0] == '.') continue;
-
-        // Relative Path regarding root (for -e/-o)
-        std::string rel;
-        {
-            std::error_code ec2;
-            auto canon = fs::weakly_canonical(entry.path(), ec2);
-            if (ec2) continue; // skip
-            rel = canon.lexically_relative(root).generic_string();
-        }
-
-        // Exclude (-e)
-        bool isExcluded = false;
-        if (!excludeList.empty()) {
-            for (const auto& ex : excludeList) {
-                if (ex == ".") continue;
-                if (ex.find('/') != std::string::npos) {
-                    if (rel == ex || rel.rfind(ex + "/", 0) == 0) { isExcluded = true; break; }
-                } else {
-                    if (filename == ex) { isExcluded = true; break; }
-                }
-            }
-        }
-        if (isExcluded) continue;
-
-        // Only (-o)
-        bool isAllowed = onlyList.empty();
-        if (!onlyList.empty()) {
-            for (const auto& allowed : onlyList) {
-                if (rel == allowed || rel.rfind(allowed + "/", 0) == 0) { 
-                    isAllowed = true; break; 
-                }
-                if (allowed.rfind(rel + "/", 0) == 0) { 
-                    isAllowed = true; break; 
-                }
-            }
-        }
-        if (!isAllowed) continue;
-
-        entries.push_back(entry.path());
-    }
-
-    // Sort for consistent order
-    std::sort(entries.begin(), entries.end());
-
-    // Iterate through collected entries and build tree structure
-    for (size_t i = 0; i < entries.size(); ++i) {
-        bool isLast = (i == entries.size() - 1);
-
-        // Name + optional size suffix
-        std::string name = entries[i].filename().string();
-        std::string sizeSuffix;
-
-        if (showSizes) {
-            std::error_code ec2;
-            if (fs::is_directory(entries[i], ec2)) {
-                auto total = dirSizeRecursive(entries[i]);
-                sizeSuffix = " (" + formatSize(total) + ")";
-            } else {
-                auto [hasSize, bytes] = fileSizeSafe(entries[i]);
-                if (hasSize) {
-                    sizeSuffix = " (" + formatSize(bytes) + ")";
-                }
-            }
-
-        }
-
-        std::cout << " " << prefix << branch(isLast) << RESET;
-        if (fs::is_directory(entries[i])) {
-            std::cout << BOLD << name << "/" << RESET << FG_GRAY << sizeSuffix << RESET <<"\n";
-        } else {
-            std::cout << name << FG_GRAY << sizeSuffix << RESET << "\n";
-        }
-        
-
-        // If directory then we call function recursively
-        if (fs::is_directory(entries[i])) {
-            printTree(root, entries[i], prefix + vertical(isLast), depth + 1);
-        }
-    }
-}
+// Commands besides drawing one tree
+struct Mode {
+    std::string rootsFile;                // '--roots-from'
+    std::vector<std::string> diffPaths;   // '--diff A B'
+    bool dupes = false;                   // '--dupes'
+    bool hash = false;                    // '--hash'
+    bool interactive = false;             // '-i'
+    bool progressive = false;             // '--progressive'
+    bool summary = false;                 // '--summary' / '--summary-only'
+    bool summaryOnly = false;
+    std::string hashCache;                // '--hash-cache'
+    std::string outputFile;               // '-O'
+    std::optional<bool> color;            // '--color always|never'; unset = auto
+    std::optional<std::chrono::milliseconds> timeout;   // '--timeout'
+    std::optional<std::size_t> maxEntries;              // '--max-entries-total'
+};
 
 // Parsing CLI arguments
-bool parseArgs(int argc, char* argv[], fs::path& root) {
+bool parseArgs(int argc, char* argv[], fs::path& root, Mode& mode, ScanOptions& scan, RenderOptions& render) {
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
 
@@ -261,7 +261,7 @@ bool parseArgs(int argc, char* argv[], fs::path& root) {
                 return false;
             }
             while (++i < argc && argv[i][0] != '-') { // Collect all files/folders to be ignored, stop if a new flag is encountered
-                excludeList.insert(argv[i]);
+                scan.exclude.add(argv[i]);
             }
             --i; // Change index after loop
         }
@@ -273,7 +273,24 @@ bool parseArgs(int argc, char* argv[], fs::path& root) {
                 return false;
             }
             while (++i < argc && argv[i][0] != '-') { // Collect all files/folders to be displayed, stop if a new flag is encountered
-                onlyList.insert(argv[i]);
+                scan.only.add(argv[i]);
+            }
+            --i; // Change index after loop
+        }
+
+        // When using '--exclude-re' or '--only-re'
+        else if (arg == "--exclude-re" || arg == "--only-re") {
+            if (i + 1 >= argc || argv[i + 1][0] == '-') {
+                std::cerr << "Error: Missing argument after '" << arg << "'. Specify at least one regex.\n";
+                return false;
+            }
+            RegexFilter& filter = arg == "--exclude-re" ? scan.excludeRegex : scan.onlyRegex;
+            while (++i < argc && argv[i][0] != '-') {
+                std::string error;
+                if (!filter.add(argv[i], error)) {
+                    std::cerr << "Error: Invalid regex '" << argv[i] << "': " << error << ".\n";
+                    return false;
+                }
             }
             --i; // Change index after loop
         }
@@ -294,7 +311,7 @@ bool parseArgs(int argc, char* argv[], fs::path& root) {
             }
             try {
                 size_t d = std::stoul(depthStr);
-                maxDepth = d;
+                scan.maxDepth = d;
             } catch(...) {
                 std::cerr << "Error: Failed to parse depth value '" << depthStr << "'.\n";
                 return false;
@@ -308,8 +325,8 @@ bool parseArgs(int argc, char* argv[], fs::path& root) {
                 return false;
             }
             std::string theme = argv[++i];
-            if (theme == "classic") currentTheme = Theme::classic;
-            else if (theme == "round") currentTheme = Theme::round;
+            if (theme == "classic") render.theme = Theme::classic;
+            else if (theme == "round") render.theme = Theme::round;
             else {
                 std::cerr << "Error: Unknown theme '" << theme << "'. Use 'classic' or 'round'.\n";
                 return false;
@@ -318,7 +335,210 @@ bool parseArgs(int argc, char* argv[], fs::path& root) {
         
         // When using '-s'
         else if (arg == "-s") {
-            showSizes = true;
+            scan.sizes = true;
+            render.sizes = true;
+        }
+
+        // When using '--gitignore'
+        else if (arg == "--gitignore") {
+            scan.gitignore = true;
+        }
+
+        // When using '--format'
+        else if (arg == "--format") {
+            if (i + 1 >= argc || argv[i + 1][0] == '-') {
+                std::cerr << "Error: Missing argument after '--format'. Specify 'tree', 'ndjson', 'json' or 'bin'.\n";
+                return false;
+            }
+            std::string format = argv[++i];
+            if (format == "tree") render.format = Format::tree;
+            else if (format == "ndjson") render.format = Format::ndjson;
+            else if (format == "json") render.format = Format::json;
+            else if (format == "bin") render.format = Format::bin;
+            else {
+                std::cerr << "Error: Unknown format '" << format << "'. Use 'tree', 'ndjson', 'json' or 'bin'.\n";
+                return false;
+            }
+        }
+
+        // When using '--sort'
+        else if (arg == "--sort") {
+            if (i + 1 >= argc || argv[i + 1][0] == '-') {
+                std::cerr << "Error: Missing argument after '--sort'. Specify 'name', 'natural' or 'locale'.\n";
+                return false;
+            }
+            std::string order = argv[++i];
+            if (order == "name") scan.sort = SortOrder::name;
+            else if (order == "natural") scan.sort = SortOrder::natural;
+            else if (order == "locale") scan.sort = SortOrder::locale;
+            else {
+                std::cerr << "Error: Unknown sort order '" << order << "'. Use 'name', 'natural' or 'locale'.\n";
+                return false;
+            }
+        }
+
+        // When using '--color'
+        else if (arg == "--color") {
+            if (i + 1 >= argc || argv[i + 1][0] == '-') {
+                std::cerr << "Error: Missing argument after '--color'. Specify 'auto', 'always' or 'never'.\n";
+                return false;
+            }
+            std::string when = argv[++i];
+            if (when == "auto") mode.color.reset();
+            else if (when == "always") mode.color = true;
+            else if (when == "never") mode.color = false;
+            else {
+                std::cerr << "Error: Unknown color mode '" << when << "'. Use 'auto', 'always' or 'never'.\n";
+                return false;
+            }
+        }
+
+        // When using '-O'
+        else if (arg == "-O") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: Missing argument after '-O'. Specify an output file.\n";
+                return false;
+            }
+            mode.outputFile = argv[++i];
+        }
+
+        // When using '--roots-from'
+        else if (arg == "--roots-from") {
+            if (i + 1 >= argc || (argv[i + 1][0] == '-' && argv[i + 1][1] != '\0')) {
+                std::cerr << "Error: Missing argument after '--roots-from'. Specify a file with one path per line, or '-'.\n";
+                return false;
+            }
+            mode.rootsFile = argv[++i];
+        }
+
+        // When using '--dupes'
+        else if (arg == "--dupes") {
+            mode.dupes = true;
+        }
+
+        // When using '--progressive'
+        else if (arg == "--progressive") {
+            mode.progressive = true;
+            scan.sizes = true;
+            scan.deferDirSizes = true;
+            render.sizes = true;
+        }
+
+        // When using '--summary' / '--summary-only'
+        else if (arg == "--summary" || arg == "--summary-only") {
+            mode.summary = true;
+            mode.summaryOnly = arg == "--summary-only";
+        }
+
+        // When using '--counts'
+        else if (arg == "--counts") {
+            scan.sizes = true;   // the counters are summed along with the sizes
+            render.counts = true;
+        }
+
+        // When using '--age' / '--age-color'
+        else if (arg == "--age" || arg == "--age-color") {
+            scan.sizes = true;   // the newest mtime is summed up along with the sizes
+            render.age = true;
+            if (arg == "--age-color") render.ageColor = true;
+        }
+
+        // When using '--bfs'
+        else if (arg == "--bfs") {
+            scan.breadthFirst = true;
+        }
+
+        // When using '-i'
+        else if (arg == "-i") {
+            mode.interactive = true;
+        }
+
+        // When using '--hash' / '--hash-cache'
+        else if (arg == "--hash") {
+            mode.hash = true;
+        }
+        else if (arg == "--hash-cache") {
+            if (i + 1 >= argc || argv[i + 1][0] == '-') {
+                std::cerr << "Error: Missing argument after '--hash-cache'. Specify a snapshot file.\n";
+                return false;
+            }
+            mode.hash = true;
+            mode.hashCache = argv[++i];
+        }
+
+        // When using '--diff'
+        else if (arg == "--diff") {
+            if (i + 2 >= argc || argv[i + 1][0] == '-' || argv[i + 2][0] == '-') {
+                std::cerr << "Error: '--diff' needs two arguments (directories or '--format bin' snapshots).\n";
+                return false;
+            }
+            mode.diffPaths = {argv[i + 1], argv[i + 2]};
+            i += 2;
+        }
+
+        // When using '--timeout' / '--max-entries-total'
+        else if (arg == "--timeout" || arg == "--max-entries-total") {
+            if (i + 1 >= argc || argv[i + 1][0] == '-') {
+                std::cerr << "Error: Missing argument after '" << arg << "'.\n";
+                return false;
+            }
+            std::string value = argv[++i];
+
+            if (arg == "--timeout") {
+                std::chrono::milliseconds timeout;
+                if (!parseDurationArg(value, timeout)) {
+                    std::cerr << "Error: Invalid time '" << value << "'. Use e.g. '500ms', '5s' or '2m'.\n";
+                    return false;
+                }
+                mode.timeout = timeout;
+            } else {
+                std::uintmax_t count;
+                if (!parseSizeArg(value, count) || count == 0) {
+                    std::cerr << "Error: Invalid count '" << value << "' for '--max-entries-total'.\n";
+                    return false;
+                }
+                mode.maxEntries = static_cast<std::size_t>(count);
+            }
+        }
+
+        // When using '--newer', '--older-than', '--min-size', '--type' or '--ext'
+        else if (arg == "--newer" || arg == "--older-than" || arg == "--min-size"
+                 || arg == "--type" || arg == "--ext") {
+            if (i + 1 >= argc || argv[i + 1][0] == '-') {
+                std::cerr << "Error: Missing argument after '" << arg << "'.\n";
+                return false;
+            }
+            std::string value = argv[++i];
+
+            if (arg == "--newer") {
+                struct stat st;
+                if (::stat(value.c_str(), &st) != 0) {
+                    std::cerr << "Error: Cannot read reference file '" << value << "' for '--newer'.\n";
+                    return false;
+                }
+                scan.predicates.newerThan = static_cast<std::int64_t>(st.st_mtime);
+            } else if (arg == "--older-than") {
+                std::int64_t age;
+                if (!parseAgeArg(value, age)) {
+                    std::cerr << "Error: Invalid age '" << value << "'. Use e.g. '30m', '12h', '7d' or '2w'.\n";
+                    return false;
+                }
+                scan.predicates.olderThan = static_cast<std::int64_t>(std::time(nullptr)) - age;
+            } else if (arg == "--min-size") {
+                std::uintmax_t bytes;
+                if (!parseSizeArg(value, bytes)) {
+                    std::cerr << "Error: Invalid size '" << value << "'. Use e.g. '512K', '100M' or '2G'.\n";
+                    return false;
+                }
+                scan.predicates.minSize = bytes;
+            } else if (arg == "--type") {
+                if (!parseTypeArg(value, scan.predicates.types)) {
+                    std::cerr << "Error: Invalid type '" << value << "'. Use 'f', 'd', 'l', 'p', 's', 'b' or 'c'.\n";
+                    return false;
+                }
+            } else {
+                addExtensions(value, scan.predicates.extensions);
+            }
         }
 
         // If no flag is provided, it is the directory path.
@@ -327,8 +547,68 @@ bool parseArgs(int argc, char* argv[], fs::path& root) {
         }
     }
 
+    // Compile all -e/-o patterns once, before the scan
+    scan.compile();
+
+    if (!mode.rootsFile.empty() && (render.format == Format::json || render.format == Format::bin)) {
+        std::cerr << "Error: '--roots-from' writes one section per root; use '--format tree' or 'ndjson'.\n";
+        return false;
+    }
+
+    if (!mode.diffPaths.empty() && render.format != Format::tree) {
+        std::cerr << "Error: '--diff' only supports the tree output.\n";
+        return false;
+    }
+    if (mode.progressive && render.format != Format::tree) {
+        std::cerr << "Error: '--progressive' only supports the tree output.\n";
+        return false;
+    }
+    if (scan.sort != SortOrder::name && (!mode.diffPaths.empty() || mode.hash || render.format == Format::bin)) {
+        std::cerr << "Error: '--sort' cannot be combined with '--diff', '--hash' or '--format bin';\n"
+                     "       they rely on entries in name order.\n";
+        return false;
+    }
+    if (mode.hash && (scan.maxDepth || mode.timeout || mode.maxEntries)) {
+        std::cerr << "Error: '--hash' needs complete folders; it cannot be combined with '-d',\n"
+                     "       '--timeout' or '--max-entries-total'.\n";
+        return false;
+    }
+    if (mode.interactive && !mode.outputFile.empty()) {
+        std::cerr << "Error: '-i' draws on the terminal; it cannot be combined with '-O'.\n";
+        return false;
+    }
+    if (mode.interactive && (mode.timeout || mode.maxEntries)) {
+        std::cerr << "Error: '-i' reads folders on demand; '--timeout' and '--max-entries-total' do not apply.\n";
+        return false;
+    }
+    if (mode.summary && render.format != Format::tree && render.format != Format::ndjson) {
+        std::cerr << "Error: '--summary' supports '--format tree' or 'ndjson'.\n";
+        return false;
+    }
+    if (mode.summary && (!mode.rootsFile.empty() || !mode.diffPaths.empty() || mode.dupes || mode.interactive)) {
+        std::cerr << "Error: '--summary' works on a single tree; it cannot be combined with '--roots-from',\n"
+                     "       '--diff', '--dupes' or '-i'.\n";
+        return false;
+    }
+    if (mode.progressive && mode.summaryOnly) {
+        std::cerr << "Error: '--progressive' draws the tree; use '--summary' instead of '--summary-only'.\n";
+        return false;
+    }
+    if (mode.progressive && (render.counts || render.age)) {
+        std::cerr << "Error: '--progressive' only fills in sizes; it cannot be combined with '--counts' or '--age'.\n";
+        return false;
+    }
+    if (mode.progressive && !mode.rootsFile.empty()) {
+        std::cerr << "Error: '--progressive' draws one tree; it cannot be combined with '--roots-from'.\n";
+        return false;
+    }
+    if (mode.dupes && render.format != Format::tree && render.format != Format::ndjson) {
+        std::cerr << "Error: '--dupes' supports '--format tree' or 'ndjson'.\n";
+        return false;
+    }
+
     // Ensure that both '-e' and '-o' were used correctly
-    if (excludeList.empty() && onlyList.empty() && argc > 1) {
+    if (scan.exclude.empty() && scan.only.empty() && argc > 1) {
         for (int i = 1; i < argc; ++i) {
             std::string arg = argv[i];
             if (arg == "-e" || arg == "-o") {
@@ -341,15 +621,213 @@ bool parseArgs(int argc, char* argv[], fs::path& root) {
     return true;
 }
 
+// Reads one root per line from 'file' ('-' = stdin); blank lines and
+// lines starting with '#' are skipped
+bool readRoots(const std::string& file, std::vector<fs::path>& roots) {
+    std::ifstream stream;
+    if (file != "-") {
+        stream.open(file);
+        if (!stream) {
+            std::cerr << "Error: Cannot read roots file '" << file << "'.\n";
+            return false;
+        }
+    }
+    std::istream& in = file == "-" ? std::cin : stream;
+
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+        roots.push_back(fs::absolute(line));
+    }
+    return true;
+}
+
+// Scans all 'roots' concurrently on one thread pool. Each scan renders into
+// its own buffer; the sections are written in input order as they finish.
+int scanBatch(OutputWriter& out, const std::vector<fs::path>& roots, const ScanOptions& scanOptions,
+              const RenderOptions& renderOptions) {
+    // '--bfs' scans share the hardware threads instead of each starting a pool of that size
+    ScanOptions options = scanOptions;
+    options.levelThreads = std::max<std::size_t>(1, std::thread::hardware_concurrency() / roots.size());
+    const Scanner scanner(std::move(options));
+    std::vector<std::string> sections(roots.size());
+    std::vector<char> done(roots.size(), 0);
+    std::vector<char> missing(roots.size(), 0);
+    std::mutex mutex;
+    std::condition_variable finished;
+
+    ThreadPool pool;
+    for (std::size_t i = 0; i < roots.size(); ++i) {
+        pool.submit([&, i] {
+            std::string section;
+            if (fs::exists(roots[i])) {
+                OutputWriter capture(-1);
+                scanner.stream(roots[i], *makeRenderer(capture, renderOptions));
+                section = std::move(capture.buffer());
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            missing[i] = section.empty();
+            sections[i] = std::move(section);
+            done[i] = 1;
+            finished.notify_all();
+        });
+    }
+
+    int status = 0;
+    for (std::size_t i = 0; i < roots.size(); ++i) {
+        std::string section;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&] { return done[i] != 0; });
+            section = std::move(sections[i]);
+        }
+        if (missing[i]) {
+            out.flush();
+            std::cerr << "Error: The specified path '" << roots[i].string() << "' does not exist. Skipping it.\n";
+            status = 1;
+            continue;
+        }
+
+        // Section header
+        if (renderOptions.format == Format::ndjson) {
+            out.buffer() += "{\"root\":";
+            appendJsonString(out.buffer(), roots[i].string());
+            out.buffer() += "}\n";
+        } else {
+            std::string& b = out.buffer();
+            b += '\n';
+            b += ansi(renderOptions.color, kBold);
+            b += "==> " + roots[i].string() + " <==";
+            b += ansi(renderOptions.color, kReset);
+            b += '\n';
+        }
+        out.buffer() += section;
+        out.commit();
+    }
+    return status;
+}
+
+// One side of '--diff': a directory is scanned, a file is read as a
+// '--format bin' snapshot
+bool loadDiffSide(const std::string& path, const ScanOptions& scanOptions, Node& tree) {
+    std::error_code ec;
+    if (fs::is_directory(path, ec)) {
+        tree = Scanner(scanOptions).scan(fs::absolute(path)).root;
+    } else if (fs::is_regular_file(path, ec)) {
+        std::string error;
+        if (!loadBinTree(path, tree, error)) {
+            std::cerr << "Error: Cannot load snapshot '" << path << "': " << error << ".\n";
+            return false;
+        }
+    } else {
+        std::cerr << "Error: The specified path '" << path << "' does not exist. Try again with a valid path.\n";
+        return false;
+    }
+    aggregateTree(tree);
+    return true;
+}
+
+// '--diff A B': both sides are loaded in parallel, then merged in one walk
+int diffMain(OutputWriter& out, const std::vector<std::string>& paths, const ScanOptions& scanOptions,
+             const RenderOptions& renderOptions) {
+    Node before, after;
+    bool okBefore = false, okAfter = false;
+    {
+        ThreadPool pool(2);
+        pool.submit([&] { okBefore = loadDiffSide(paths[0], scanOptions, before); });
+        pool.submit([&] { okAfter = loadDiffSide(paths[1], scanOptions, after); });
+        pool.wait();
+    }
+    if (!okBefore || !okAfter) return 1;
+
+    DiffCounts counts;
+    DiffNode merged = diffTrees(before, after, counts);
+
+    writeDiffTree(out, merged, paths[0], paths[1], counts, renderOptions.theme, renderOptions.color);
+    return 0;
+}
+
+// Appends the '--summary' section in the output format
+void writeSummary(OutputWriter& out, const Summary& summary, const RenderOptions& options) {
+    if (options.format == Format::ndjson) summary.writeNdjson(out.buffer());
+    else summary.writeText(out.buffer(), options.color);
+    out.flush();
+}
+
+// Tells on stderr that the output above is incomplete
+void reportBudget(ScanBudget* budget) {
+    if (!budget || !budget->spent()) return;
+    std::cerr << "Warning: " << (budget->timedOut() ? "The time limit ('--timeout')" : "The entry limit ('--max-entries-total')")
+              << " was reached; folders marked '(not scanned)' were not read completely.\n";
+}
+
+// Writes what is left of the output and returns the exit status: 'status',
+// or 1 if a write failed (e.g. '-O' on a full disk)
+int finishOutput(OutputWriter& out, const Mode& mode, ScanBudget* budget, int status) {
+    out.flush();
+    if (!out.ok()) {
+        std::cerr << "Error: Cannot write to '" << (mode.outputFile.empty() ? "stdout" : mode.outputFile) << "'.\n";
+        return 1;
+    }
+    reportBudget(budget);
+    return status;
+}
+
 // Main program
 int main(int argc, char* argv[]) {
     fs::path root;
+    Mode mode;
+    ScanOptions scanOptions;
+    RenderOptions renderOptions;
 
     // Parse CLI arguments and check for errors
-    if (!parseArgs(argc, argv, root)) {
+    if (!parseArgs(argc, argv, root, mode, scanOptions, renderOptions)) {
         return 1; // Exit on error
     }
 
+    // '-O': the file takes the place of stdout for every writer below
+    if (!mode.outputFile.empty()) {
+        int fd = ::open(mode.outputFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        if (fd < 0 || ::dup2(fd, STDOUT_FILENO) < 0) {
+            std::cerr << "Error: Cannot write to '" << mode.outputFile << "'.\n";
+            return 1;
+        }
+        if (fd != STDOUT_FILENO) ::close(fd);
+    }
+
+    // '--sort locale' collates by the user's locale; keys are made with strxfrm()
+    if (scanOptions.sort == SortOrder::locale) std::setlocale(LC_COLLATE, "");
+
+    // '--color auto': styles only when stdout (after '-O') is a terminal
+    const bool terminal = ::isatty(STDOUT_FILENO) != 0;
+    renderOptions.color = mode.color.value_or(terminal);
+
+    // Time and entry limits, shared by every scan below
+    std::optional<ScanBudget> budget;
+    if (mode.timeout || mode.maxEntries) {
+        budget.emplace(mode.timeout, mode.maxEntries);
+        scanOptions.budget = &*budget;
+    }
+
+    OutputWriter out;
+
+    // Compare two trees
+    if (!mode.diffPaths.empty()) {
+        int status = diffMain(out, mode.diffPaths, scanOptions, renderOptions);
+        return finishOutput(out, mode, scanOptions.budget, status);
+    }
+
+    // Batch mode: many roots, scanned in parallel
+    if (!mode.rootsFile.empty()) {
+        std::vector<fs::path> roots;
+        if (!root.empty()) roots.push_back(root);
+        if (!readRoots(mode.rootsFile, roots)) return 1;
+        int status = scanBatch(out, roots, scanOptions, renderOptions);
+        return finishOutput(out, mode, scanOptions.budget, status);
+    }
+
     // General case use local directory path
     if (root.empty()) {
         root = fs::current_path();
@@ -361,27 +839,65 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    std::cout << std::endl;
+    // Browse interactively
+    if (mode.interactive) {
+        return runInteractive(root, scanOptions, renderOptions.theme);
+    }
+
+    Summary summary;
 
-    std::string sizeSuffix;
-    if (showSizes) {
-        std::error_code ec;
-        if (fs::is_directory(root, ec)) {
-            auto total = dirSizeRecursive(root);
-            sizeSuffix = " (" + formatSize(total) + ")";
-        } else {
-            auto [hasSize, bytes] = fileSizeSafe(root);
-            if (hasSize) {
-                sizeSuffix = " (" + formatSize(bytes) + ")";
-            }
-        }
+    // Duplicate files below root
+    if (mode.dupes) {
+        Tree tree = Scanner(scanOptions).scan(root);
+        ThreadPool pool;
+        std::vector<DupeGroup> groups = findDuplicates(tree, pool);
+        if (renderOptions.format == Format::ndjson) writeDupesNdjson(out, groups);
+        else writeDupesTree(out, tree, groups, renderOptions.theme, renderOptions.color);
+        return finishOutput(out, mode, scanOptions.budget, 0);
     }
 
-    // Display root directory
-    std::cout << " " << BOLD << root.filename().string() << "/" << RESET << FG_GRAY << sizeSuffix << RESET <<"\n";
+    // Content and Merkle hashes, optionally reusing and updating a snapshot
+    if (mode.hash) {
+        Tree tree = Scanner(scanOptions).scan(root);
+        HashCache cache;
+        std::string error;
+        if (!mode.hashCache.empty() && fs::exists(mode.hashCache)) {
+            Node snapshot;
+            if (loadBinTree(mode.hashCache, snapshot, error)) cache.add(snapshot);
+            else std::cerr << "Warning: Ignoring hash cache '" << mode.hashCache << "': " << error << ".\n";
+        }
 
-    // Start recursive scan
-    printTree(root, root);
+        ThreadPool pool;
+        HashStats stats = hashTree(tree, cache, pool);
+        if (stats.failed > 0) {
+            std::cerr << "Warning: " << stats.failed << " file(s) could not be read and have no hash.\n";
+        }
+        if (!mode.hashCache.empty() && !saveBinTree(mode.hashCache, tree.root, error)) {
+            std::cerr << "Error: Cannot write hash cache '" << mode.hashCache << "': " << error << ".\n";
+            return 1;
+        }
+        std::unique_ptr<Renderer> renderer = mode.summaryOnly ? nullptr : makeRenderer(out, renderOptions);
+        SummaryRenderer summarized(renderer.get(), summary);
+        if (mode.summary) summarized.render(tree);
+        else renderer->render(tree);
+        if (mode.summary) writeSummary(out, summary, renderOptions);
+        return finishOutput(out, mode, scanOptions.budget, 0);
+    }
 
-    return 0;
+    // Tree first, folder sizes as they arrive
+    if (mode.progressive) {
+        const Scanner scanner(scanOptions);
+        ProgressiveRenderer renderer(out, renderOptions, scanner, root, terminal);
+        SummaryRenderer summarized(&renderer, summary);
+        scanner.stream(root, mode.summary ? static_cast<Renderer&>(summarized) : renderer);
+        renderer.finish();
+        if (mode.summary) writeSummary(out, summary, renderOptions);
+        return finishOutput(out, mode, scanOptions.budget, 0);
+    }
+
+    std::unique_ptr<Renderer> renderer = mode.summaryOnly ? nullptr : makeRenderer(out, renderOptions);
+    SummaryRenderer summarized(renderer.get(), summary);
+    Scanner(scanOptions).stream(root, mode.summary ? static_cast<Renderer&>(summarized) : *renderer);
+    if (mode.summary) writeSummary(out, summary, renderOptions);
+    return finishOutput(out, mode, scanOptions.budget, 0);
 }
\ No newline at end of file
@@ -0,0 +1,230 @@
+#include "appletree/automaton.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace appletree {
+
+namespace {
+
+using StateSet = std::vector<int>;
+
+struct StateSetHash {
+    std::size_t operator()(const StateSet& v) const {
+        std::size_t h = v.size();
+        for (int x : v) h = h * 1000003u ^ static_cast<std::size_t>(x);
+        return h;
+    }
+};
+
+constexpr int kDead = 0;
+constexpr int kUnbuilt = -1;
+constexpr int kFull = -2;   // cache is full, continue on the NFA
+
+} // namespace
+
+struct Dfa::Impl {
+    Nfa nfa;
+    std::size_t maxStates;
+    std::uint8_t classOf[256] = {};
+    std::size_t classes = 1;
+    std::vector<unsigned char> representative;   // one byte per class
+    int start = kDead;
+
+    // Published part: written once per slot, read without the mutex
+    std::unique_ptr<std::atomic<int>[]> next;    // state * classes + class
+    std::unique_ptr<int[]> accept;               // per state
+
+    // Guarded by 'mutex'
+    std::mutex mutex;
+    std::deque<StateSet> sets;                   // NFA states behind each DFA state
+    std::unordered_map<StateSet, int, StateSetHash> ids;
+    std::vector<char> seen;                      // scratch for closure()
+
+    Impl(Nfa n, std::size_t max) : nfa(std::move(n)), maxStates(std::max<std::size_t>(max, 2)) {}
+
+    void computeClasses();
+    void closure(StateSet& set, std::vector<char>& scratch) const;
+    StateSet move(const StateSet& set, unsigned char c, std::vector<char>& scratch) const;
+    int acceptOf(const StateSet& set) const;
+    int addState(StateSet set);   // mutex held
+    int build(int state, unsigned char c);
+    StateSet setOf(int state);
+
+    int step(int state, unsigned char c) {
+        int nx = next[state * classes + classOf[c]].load(std::memory_order_acquire);
+        return nx == kUnbuilt ? build(state, c) : nx;
+    }
+};
+
+void Dfa::Impl::computeClasses() {
+    // Bytes that no transition tells apart share a column
+    std::unordered_set<std::bitset<256>> byteSets;
+    for (int i = 0; i < nfa.size(); ++i) {
+        if (nfa[i].next >= 0) byteSets.insert(nfa[i].bytes);
+    }
+    std::vector<int> cls(256, 0);
+    int count = 1;
+    for (const auto& set : byteSets) {
+        // Split every class into its members inside / outside 'set'
+        std::vector<int> inside(count, -1), outside(count, -1);
+        int id = 0;
+        for (int b = 0; b < 256; ++b) {
+            int& slot = set[b] ? inside[cls[b]] : outside[cls[b]];
+            if (slot < 0) slot = id++;
+            cls[b] = slot;
+        }
+        count = id;
+    }
+    classes = static_cast<std::size_t>(count);
+    representative.assign(classes, 0);
+    for (int b = 255; b >= 0; --b) {
+        classOf[b] = static_cast<std::uint8_t>(cls[b]);
+        representative[cls[b]] = static_cast<unsigned char>(b);
+    }
+}
+
+void Dfa::Impl::closure(StateSet& set, std::vector<char>& scratch) const {
+    std::vector<int> stack;
+    stack.swap(set);
+    while (!stack.empty()) {
+        int s = stack.back();
+        stack.pop_back();
+        if (scratch[s]) continue;
+        scratch[s] = 1;
+        set.push_back(s);
+        for (int e : nfa[s].eps) stack.push_back(e);
+    }
+    for (int s : set) scratch[s] = 0;
+    std::sort(set.begin(), set.end());
+}
+
+StateSet Dfa::Impl::move(const StateSet& set, unsigned char c, std::vector<char>& scratch) const {
+    StateSet out;
+    for (int s : set) {
+        const NfaState& st = nfa[s];
+        if (st.next >= 0 && st.bytes[c]) out.push_back(st.next);
+    }
+    closure(out, scratch);
+    return out;
+}
+
+int Dfa::Impl::acceptOf(const StateSet& set) const {
+    int best = -1;
+    for (int s : set) best = std::max(best, nfa[s].accept);
+    return best;
+}
+
+int Dfa::Impl::addState(StateSet set) {
+    int id = static_cast<int>(sets.size());
+    accept[id] = acceptOf(set);
+    ids.emplace(set, id);
+    sets.push_back(std::move(set));
+    return id;
+}
+
+int Dfa::Impl::build(int state, unsigned char c) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::atomic<int>& slot = next[state * classes + classOf[c]];
+    int nx = slot.load(std::memory_order_relaxed);
+    if (nx != kUnbuilt) return nx;   // another thread was faster
+
+    StateSet target = move(sets[state], representative[classOf[c]], seen);
+    auto it = ids.find(target);
+    if (it != ids.end()) {
+        nx = it->second;
+    } else if (sets.size() < maxStates) {
+        nx = addState(std::move(target));
+    } else {
+        return kFull;
+    }
+    slot.store(nx, std::memory_order_release);
+    return nx;
+}
+
+StateSet Dfa::Impl::setOf(int state) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return sets[state];
+}
+
+Dfa::Dfa(Nfa nfa, std::size_t maxStates) {
+    if (nfa.starts().empty()) return;
+    impl_ = std::make_shared<Impl>(std::move(nfa), maxStates);
+    Impl& d = *impl_;
+    d.computeClasses();
+
+    const std::size_t slots = d.maxStates * d.classes;
+    d.next.reset(new std::atomic<int>[slots]);
+    for (std::size_t i = 0; i < slots; ++i) d.next[i].store(kUnbuilt, std::memory_order_relaxed);
+    d.accept.reset(new int[d.maxStates]);
+    d.seen.assign(d.nfa.size(), 0);
+
+    d.addState(StateSet());   // kDead
+    for (std::size_t c = 0; c < d.classes; ++c) d.next[c].store(kDead, std::memory_order_relaxed);
+
+    StateSet startSet(d.nfa.starts());
+    d.closure(startSet, d.seen);
+    d.start = d.addState(std::move(startSet));
+}
+
+namespace {
+
+// Slow path once the state cache is full: plain NFA simulation, still linear
+template <class Impl>
+DfaRun runNfa(const Impl& d, StateSet set, std::string_view rest, DfaRun r) {
+    std::vector<char> scratch(d.nfa.size(), 0);
+    for (char ch : rest) {
+        if (set.empty()) return r;
+        const int acc = d.acceptOf(set);
+        r.acceptAny = std::max(r.acceptAny, acc);
+        if (ch == '/') r.acceptBoundary = std::max(r.acceptBoundary, acc);
+        set = d.move(set, static_cast<unsigned char>(ch), scratch);
+    }
+    if (set.empty()) return r;
+
+    const int acc = d.acceptOf(set);
+    r.acceptEnd = acc;
+    r.acceptAny = std::max(r.acceptAny, acc);
+    r.acceptBoundary = std::max(r.acceptBoundary, acc);
+    r.liveBelow = !d.move(set, '/', scratch).empty();
+    return r;
+}
+
+} // namespace
+
+DfaRun Dfa::run(std::string_view s) const {
+    DfaRun r;
+    if (!impl_) return r;
+    Impl& d = *impl_;
+
+    int st = d.start;
+    for (std::size_t i = 0; i < s.size(); ++i) {
+        const int acc = d.accept[st];
+        r.acceptAny = std::max(r.acceptAny, acc);
+        if (s[i] == '/') r.acceptBoundary = std::max(r.acceptBoundary, acc);
+
+        const int nx = d.step(st, static_cast<unsigned char>(s[i]));
+        if (nx == kDead) return r;
+        if (nx == kFull) return runNfa(d, d.setOf(st), s.substr(i), r);
+        st = nx;
+    }
+
+    const int acc = d.accept[st];
+    r.acceptEnd = acc;
+    r.acceptAny = std::max(r.acceptAny, acc);
+    r.acceptBoundary = std::max(r.acceptBoundary, acc);
+    const int below = d.step(st, '/');
+    if (below == kFull) {
+        std::vector<char> scratch(d.nfa.size(), 0);
+        r.liveBelow = !d.move(d.setOf(st), '/', scratch).empty();
+    } else {
+        r.liveBelow = below != kDead;
+    }
+    return r;
+}
+
+} // namespace appletree
@@ -0,0 +1,160 @@
+#include "appletree/binfmt.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <vector>
+
+#include "appletree/tree.h"
+
+namespace appletree {
+
+namespace {
+
+void storeLE(char* p, std::uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        p[i] = static_cast<char>(v & 0xFF);
+        v >>= 8;
+    }
+}
+
+void appendBinNode(std::string& out, const Node& node, std::uint32_t depth) {
+    appendBinRecord(out, depth, static_cast<std::uint8_t>(node.type), node.size.has_value(),
+                    node.size.value_or(0), node.mtime, node.name, node.hash.has_value(),
+                    node.dev, node.ino, node.mtimeNs, node.ctimeNs, node.hash.value_or(0));
+    for (const Node& child : node.children) appendBinNode(out, child, depth + 1);
+}
+
+} // namespace
+
+void appendBinHeader(std::string& out) {
+    char header[kBinHeaderSize];
+    std::memcpy(header, kBinMagic, 4);
+    storeLE(header + 4, kBinVersion, 4);
+    out.append(header, sizeof(header));
+}
+
+void appendBinRecord(std::string& out, std::uint32_t depth, std::uint8_t type,
+                     bool hasSize, std::uint64_t size, std::int64_t mtime,
+                     std::string_view name, bool hasHash,
+                     std::uint64_t dev, std::uint64_t ino, std::int64_t mtimeNs,
+                     std::int64_t ctimeNs, std::uint64_t hash) {
+    if (name.size() > 0xFFFF) name = name.substr(0, 0xFFFF);
+    const std::size_t nameEnd = (kBinRecordFixedSize + name.size() + 7) & ~std::size_t(7);
+    const std::size_t recordSize = nameEnd + (hasHash ? kBinHashBlockSize : 0);
+
+    const std::size_t at = out.size();
+    out.resize(at + recordSize);
+    char* p = &out[at];
+    storeLE(p, recordSize, 4);
+    storeLE(p + 4, depth, 4);
+    storeLE(p + 8, hasSize ? size : 0, 8);
+    storeLE(p + 16, static_cast<std::uint64_t>(mtime), 8);
+    p[24] = static_cast<char>(type);
+    p[25] = static_cast<char>((hasSize ? kBinHasSize : 0) | (hasHash ? kBinHasHash : 0));
+    storeLE(p + 26, name.size(), 2);
+    std::memcpy(p + kBinRecordFixedSize, name.data(), name.size());
+    std::memset(p + kBinRecordFixedSize + name.size(), 0, nameEnd - kBinRecordFixedSize - name.size());
+    if (hasHash) {
+        storeLE(p + nameEnd, dev, 8);
+        storeLE(p + nameEnd + 8, ino, 8);
+        storeLE(p + nameEnd + 16, static_cast<std::uint64_t>(mtimeNs), 8);
+        storeLE(p + nameEnd + 24, static_cast<std::uint64_t>(ctimeNs), 8);
+        storeLE(p + nameEnd + 32, hash, 8);
+    }
+}
+
+bool loadBinTree(const std::string& path, Node& root, std::string& error) {
+    BinFile file(path.c_str());
+    if (!file.ok()) {
+        error = "cannot read file";
+        return false;
+    }
+    BinReader reader = file.reader();
+    if (!reader.valid()) {
+        if (reader.version() == 0) error = "not an appletree binary snapshot";
+        else error = "snapshot format " + std::to_string(reader.version()) + " is not supported (this build writes " +
+                     std::to_string(kBinVersion) + ")";
+        return false;
+    }
+
+    // stack[d] = last entry seen at depth d; only its ancestors are ever
+    // appended to, so the pointers stay valid
+    std::vector<Node*> stack;
+    BinRecord rec;
+    while (reader.next(rec)) {
+        if (rec.depth > stack.size() || (rec.depth == 0 && !stack.empty())) {
+            error = "records out of order";
+            return false;
+        }
+
+        Node* node;
+        if (rec.depth == 0) {
+            node = &root;
+        } else {
+            Node* parent = stack[rec.depth - 1];
+            parent->isDir = true;
+            parent->children.emplace_back();
+            node = &parent->children.back();
+        }
+        node->name = std::string(rec.name);
+        node->type = rec.type <= static_cast<std::uint8_t>(EntryType::other)
+                   ? static_cast<EntryType>(rec.type) : EntryType::other;
+        node->isDir = node->type == EntryType::directory;
+        node->mtime = rec.mtime;
+        if (rec.hasSize()) node->size = rec.size;
+        if (rec.hasHash()) {
+            node->dev = rec.dev;
+            node->ino = rec.ino;
+            node->mtimeNs = rec.mtimeNs;
+            node->ctimeNs = rec.ctimeNs;
+            node->hash = rec.hash;
+        }
+
+        stack.resize(rec.depth);
+        stack.push_back(node);
+    }
+    if (!reader.atEnd()) {
+        error = "truncated or corrupt snapshot";
+        return false;
+    }
+    if (stack.empty()) {
+        error = "empty snapshot";
+        return false;
+    }
+    return true;
+}
+
+bool saveBinTree(const std::string& path, const Node& root, std::string& error) {
+    std::string data;
+    appendBinHeader(data);
+    appendBinNode(data, root, 0);
+
+    const std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = std::strerror(errno);
+        return false;
+    }
+    const char* p = data.data();
+    std::size_t left = data.size();
+    while (left > 0) {
+        ssize_t n = ::write(fd, p, left);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            error = std::strerror(errno);
+            ::close(fd);
+            ::unlink(tmp.c_str());
+            return false;
+        }
+        p += n;
+        left -= static_cast<std::size_t>(n);
+    }
+    if (::close(fd) != 0 || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        error = std::strerror(errno);
+        ::unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace appletree
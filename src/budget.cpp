@@ -0,0 +1,146 @@
+#include "appletree/budget.h"
+
+#include <cctype>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+namespace appletree {
+
+namespace fs = std::filesystem;
+
+ScanBudget::ScanBudget(std::optional<std::chrono::milliseconds> timeout, std::optional<std::size_t> maxEntries)
+    : maxEntries_(maxEntries) {
+    if (timeout) {
+        hasDeadline_ = true;
+        deadline_ = Clock::now() + *timeout;
+    }
+}
+
+std::size_t ScanBudget::remaining() const {
+    if (!maxEntries_) return std::numeric_limits<std::size_t>::max();
+    std::size_t used = used_.load(std::memory_order_relaxed);
+    return used < *maxEntries_ ? *maxEntries_ - used : 0;
+}
+
+bool ScanBudget::spent() {
+    if (spent_.load(std::memory_order_relaxed)) return true;
+    if (hasDeadline_ && Clock::now() >= deadline_) {
+        expire();
+        return true;
+    }
+    if (maxEntries_ && used_.load(std::memory_order_relaxed) >= *maxEntries_) {
+        spent_.store(true, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+bool parseDurationArg(const std::string& s, std::chrono::milliseconds& duration) {
+    if (s.empty() || !std::isdigit(static_cast<unsigned char>(s[0]))) return false;
+    char* end = nullptr;
+    double value = std::strtod(s.c_str(), &end);
+    std::string unit(end);
+
+    double scale;
+    if (unit.empty() || unit == "s") scale = 1000;
+    else if (unit == "ms") scale = 1;
+    else if (unit == "m") scale = 60 * 1000;
+    else if (unit == "h") scale = 3600 * 1000;
+    else return false;
+
+    duration = std::chrono::milliseconds(static_cast<std::int64_t>(value * scale));
+    return true;
+}
+
+bool readDirectory(const fs::path& dir, std::vector<DirEntry>& out, std::size_t limit) {
+    std::error_code ec;
+    for (fs::directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec);
+         !ec && it != fs::directory_iterator(); it.increment(ec)) {
+        if (out.size() >= limit) return false;
+        std::error_code ec2;
+        DirEntry entry;
+        entry.path = it->path();
+        entry.isDir = it->is_directory(ec2);
+        entry.isLink = it->is_symlink(ec2);
+        out.push_back(std::move(entry));
+    }
+    return true;
+}
+
+// The request slot between a DirReader and its thread
+struct DirReader::Shared {
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    fs::path dir;
+    std::size_t limit = 0;
+    std::vector<DirEntry> entries;
+    bool pending = false;         // request waiting for the thread
+    bool finished = false;        // result ready
+    bool complete = false;
+    bool quit = false;
+    std::thread thread;
+};
+
+DirReader::DirReader(ScanBudget::Clock::time_point deadline) : shared_(std::make_shared<Shared>()), deadline_(deadline) {}
+
+DirReader::~DirReader() {
+    if (!shared_->thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(shared_->mutex);
+        shared_->quit = true;
+    }
+    shared_->wake.notify_one();
+    if (abandoned_) shared_->thread.detach();
+    else shared_->thread.join();
+}
+
+DirReader::Result DirReader::read(const fs::path& dir, std::vector<DirEntry>& out, std::size_t limit) {
+    if (abandoned_) return Result::timedOut;
+
+    if (!shared_->thread.joinable()) {
+        // Owns a reference, so an abandoned thread never touches freed state
+        std::shared_ptr<Shared> shared = shared_;
+        shared_->thread = std::thread([shared] {
+            std::unique_lock<std::mutex> lock(shared->mutex);
+            for (;;) {
+                shared->wake.wait(lock, [&] { return shared->pending || shared->quit; });
+                if (shared->quit) return;
+                shared->pending = false;
+                fs::path dir = shared->dir;
+                std::size_t limit = shared->limit;
+                lock.unlock();
+
+                std::vector<DirEntry> entries;
+                bool complete = readDirectory(dir, entries, limit);
+
+                lock.lock();
+                shared->entries = std::move(entries);
+                shared->complete = complete;
+                shared->finished = true;
+                shared->done.notify_one();
+            }
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(shared_->mutex);
+    shared_->dir = dir;
+    shared_->limit = limit;
+    shared_->pending = true;
+    shared_->finished = false;
+    shared_->wake.notify_one();
+    if (!shared_->done.wait_until(lock, deadline_, [this] { return shared_->finished; })) {
+        abandoned_ = true;
+        return Result::timedOut;
+    }
+    out = std::move(shared_->entries);
+    shared_->entries.clear();
+    return shared_->complete ? Result::complete : Result::cut;
+}
+
+} // namespace appletree
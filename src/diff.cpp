@@ -0,0 +1,226 @@
+#include "appletree/diff.h"
+
+#include <functional>
+#include <utility>
+
+#include "appletree/format.h"
+
+namespace appletree {
+
+namespace {
+
+// splitmix64 finalizer
+std::uint64_t mix(std::uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+} // namespace
+
+void aggregateTree(Node& node) {
+    std::uint64_t own = std::hash<std::string>()(node.name);
+    own = mix(own ^ static_cast<std::uint64_t>(node.type));
+    if (!node.isDir) {
+        own = mix(own ^ static_cast<std::uint64_t>(node.mtime));
+        node.digest = mix(own ^ node.size.value_or(0));
+        return;
+    }
+
+    // A directory's own mtime is left out: it changes whenever the folder is
+    // recreated (e.g. extracted again), and diffEntry() never reports it
+
+    // Children are summed, so the digest does not depend on their order
+    std::uintmax_t total = 0;
+    std::uint64_t children = 0;
+    for (Node& child : node.children) {
+        aggregateTree(child);
+        if (child.isDir || child.type == EntryType::file) total += child.size.value_or(0);
+        children += child.digest;
+    }
+    node.size = total;
+    node.digest = mix(own + mix(children));
+}
+
+namespace {
+
+DiffNode wholeEntry(const Node& node, std::uint8_t change, DiffCounts& counts) {
+    DiffNode d;
+    d.name = node.name;
+    d.isDir = node.isDir;
+    d.change = change;
+    if (change == kDiffAdded) {
+        d.newSize = node.size;
+        ++counts.added;
+    } else {
+        d.oldSize = node.size;
+        ++counts.removed;
+    }
+    return d;
+}
+
+void diffChildren(const Node& before, const Node& after, DiffNode& out, DiffCounts& counts);
+
+// Compares two entries with the same name
+void diffEntry(const Node& a, const Node& b, DiffNode& parent, DiffCounts& counts) {
+    // A file that became a directory (or link) is one removal plus one addition
+    if (a.isDir != b.isDir || a.type != b.type) {
+        parent.children.push_back(wholeEntry(a, kDiffRemoved, counts));
+        parent.children.push_back(wholeEntry(b, kDiffAdded, counts));
+        return;
+    }
+
+    if (a.isDir) {
+        // Same total size and same metadata fingerprint: assume an identical subtree
+        if (a.size == b.size && a.digest == b.digest) return;
+
+        DiffNode d;
+        d.name = a.name;
+        d.isDir = true;
+        diffChildren(a, b, d, counts);
+        if (!d.children.empty()) parent.children.push_back(std::move(d));
+        return;
+    }
+
+    std::uint8_t change = 0;
+    if (a.type == EntryType::file && a.size != b.size) change |= kDiffSize;
+    if (a.mtime != b.mtime) change |= kDiffMtime;
+    if (change == 0) return;
+
+    DiffNode d;
+    d.name = a.name;
+    d.change = change;
+    d.oldSize = a.size;
+    d.newSize = b.size;
+    parent.children.push_back(std::move(d));
+    ++counts.changed;
+}
+
+// Sorted merge of both child lists
+void diffChildren(const Node& before, const Node& after, DiffNode& out, DiffCounts& counts) {
+    const auto& a = before.children;
+    const auto& b = after.children;
+    std::size_t i = 0, j = 0;
+    while (i < a.size() || j < b.size()) {
+        int cmp = i == a.size() ? 1 : j == b.size() ? -1 : a[i].name.compare(b[j].name);
+        if (cmp < 0) {
+            out.children.push_back(wholeEntry(a[i++], kDiffRemoved, counts));
+        } else if (cmp > 0) {
+            out.children.push_back(wholeEntry(b[j++], kDiffAdded, counts));
+        } else {
+            diffEntry(a[i++], b[j++], out, counts);
+        }
+    }
+}
+
+void appendCount(std::string& out, std::size_t n) {
+    char digits[20];
+    out.append(digits, formatUnsignedTo(digits, n));
+}
+
+void appendName(std::string& out, const DiffNode& node) {
+    out += node.name;
+    if (node.isDir) out += '/';
+}
+
+void appendDiffLine(std::string& out, const DiffNode& node, bool color) {
+    if (node.change & kDiffAdded) {
+        out += ansi(color, kFgGreen);
+        out += "+ ";
+        appendName(out, node);
+        out += ansi(color, kReset);
+        appendSizeSuffix(out, node.newSize, color);
+    } else if (node.change & kDiffRemoved) {
+        out += ansi(color, kFgRed);
+        out += "- ";
+        appendName(out, node);
+        out += ansi(color, kReset);
+        appendSizeSuffix(out, node.oldSize, color);
+    } else if (node.change & kDiffSize) {
+        out += ansi(color, kFgYellow);
+        out += "~ ";
+        appendName(out, node);
+        out += ansi(color, kReset);
+        out += ansi(color, kFgGray);
+        out += " (";
+        appendSize(out, node.oldSize.value_or(0));
+        out += " → ";
+        appendSize(out, node.newSize.value_or(0));
+        out += ')';
+        out += ansi(color, kReset);
+    } else if (node.change & kDiffMtime) {
+        out += ansi(color, kFgCyan);
+        out += "* ";
+        appendName(out, node);
+        out += ansi(color, kReset);
+    } else {
+        out += ansi(color, kBold);
+        appendName(out, node);
+        out += ansi(color, kReset);
+    }
+    out += '\n';
+}
+
+void writeDiffChildren(OutputWriter& out, const DiffNode& dir, std::string& prefix, Theme theme, bool color) {
+    for (std::size_t i = 0; i < dir.children.size(); ++i) {
+        const DiffNode& child = dir.children[i];
+        bool isLast = (i == dir.children.size() - 1);
+
+        std::string& b = out.buffer();
+        b += ' ';
+        b += prefix;
+        b += branch(theme, isLast);
+        b += ansi(color, kReset);
+        appendDiffLine(b, child, color);
+        out.commit();
+
+        if (!child.children.empty()) {
+            std::size_t length = prefix.size();
+            prefix += vertical(theme, isLast);
+            writeDiffChildren(out, child, prefix, theme, color);
+            prefix.resize(length);
+        }
+    }
+}
+
+} // namespace
+
+DiffNode diffTrees(const Node& before, const Node& after, DiffCounts& counts) {
+    DiffNode root;
+    root.name = after.name;
+    root.isDir = true;
+    diffChildren(before, after, root, counts);
+    return root;
+}
+
+void writeDiffTree(OutputWriter& out, const DiffNode& root, const std::string& beforeLabel,
+                   const std::string& afterLabel, const DiffCounts& counts, Theme theme, bool color) {
+    std::string& b = out.buffer();
+    b += "\n ";
+    b += ansi(color, kBold);
+    b += beforeLabel;
+    b += ansi(color, kReset);
+    b += " → ";
+    b += ansi(color, kBold);
+    b += afterLabel;
+    b += ansi(color, kReset);
+    b += '\n';
+
+    std::string prefix;
+    writeDiffChildren(out, root, prefix, theme, color);
+
+    std::string& tail = out.buffer();
+    tail += "\n ";
+    appendCount(tail, counts.added);
+    tail += " added, ";
+    appendCount(tail, counts.removed);
+    tail += " removed, ";
+    appendCount(tail, counts.changed);
+    tail += " changed\n";
+    out.commit();
+}
+
+} // namespace appletree
@@ -0,0 +1,315 @@
+#include "appletree/dupes.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <sys/stat.h>
+
+#include "appletree/format.h"
+#include "appletree/hash.h"
+#include "appletree/json.h"
+
+namespace appletree {
+
+namespace {
+
+constexpr std::size_t kEdgeBytes = 4096;
+
+struct Candidate {
+    const Node* node;
+    std::string rel;
+    std::uintmax_t size;
+    std::uint64_t hash = 0;       // edge hash, then full hash
+    bool ok = true;
+    std::size_t copyOf = 0;       // first candidate with the same bytes (itself if none before)
+};
+
+void collectFiles(const Node& node, std::string& rel, std::vector<Candidate>& out) {
+    std::size_t length = rel.size();
+    for (const Node& child : node.children) {
+        if (length > 0) rel += '/';
+        rel += child.name;
+        if (child.type == EntryType::file && child.size.value_or(0) > 0) {
+            out.push_back(Candidate{&child, rel, *child.size});
+        } else if (child.isDir) {
+            collectFiles(child, rel, out);
+        }
+        rel.resize(length);
+    }
+}
+
+// Runs fn(i) for i in [0, n) on the pool in chunks of 'chunk'
+void parallelFor(ThreadPool& pool, std::size_t n, std::size_t chunk, const std::function<void(std::size_t)>& fn) {
+    for (std::size_t begin = 0; begin < n; begin += chunk) {
+        std::size_t end = std::min(n, begin + chunk);
+        pool.submit([&fn, begin, end] {
+            for (std::size_t i = begin; i < end; ++i) fn(i);
+        });
+    }
+    pool.wait();
+}
+
+// Keeps only candidates whose (size, hash) occurs at least twice
+std::vector<Candidate> keepRepeated(std::vector<Candidate> list) {
+    list.erase(std::remove_if(list.begin(), list.end(), [](const Candidate& c) { return !c.ok; }), list.end());
+    std::sort(list.begin(), list.end(), [](const Candidate& a, const Candidate& b) {
+        return a.size != b.size ? a.size < b.size : a.hash < b.hash;
+    });
+
+    std::vector<Candidate> kept;
+    for (std::size_t i = 0; i < list.size();) {
+        std::size_t j = i + 1;
+        while (j < list.size() && list[j].size == list[i].size && list[j].hash == list[i].hash) ++j;
+        if (j - i > 1) {
+            for (std::size_t k = i; k < j; ++k) kept.push_back(std::move(list[k]));
+        }
+        i = j;
+    }
+    return kept;
+}
+
+std::string absolutePath(const Tree& tree, const std::string& rel) {
+    return (tree.path / rel).string();
+}
+
+} // namespace
+
+std::vector<DupeGroup> findDuplicates(const Tree& tree, ThreadPool& pool) {
+    std::vector<Candidate> files;
+    std::string rel;
+    collectFiles(tree.root, rel, files);
+
+    // Round 1: only sizes that occur more than once (hash still 0)
+    files = keepRepeated(std::move(files));
+
+    // Round 2: first and last 4 KiB
+    parallelFor(pool, files.size(), 64, [&](std::size_t i) {
+        Candidate& c = files[i];
+        c.ok = hashFileEdges(absolutePath(tree, c.rel).c_str(), c.size, kEdgeBytes, c.hash);
+    });
+    files = keepRepeated(std::move(files));
+
+    // Round 3: whole content, unless the edges already covered all of it
+    parallelFor(pool, files.size(), 1, [&](std::size_t i) {
+        Candidate& c = files[i];
+        if (c.size <= 2 * kEdgeBytes) return;
+        std::uint64_t bytes = 0;
+        c.ok = hashFile(absolutePath(tree, c.rel).c_str(), c.hash, bytes) && bytes == c.size;
+    });
+    files = keepRepeated(std::move(files));
+
+    // Round 4: an equal hash only makes a candidate; the bytes decide, so a
+    // hash collision never reports different files as copies
+    std::vector<std::pair<std::size_t, std::size_t>> runs;
+    for (std::size_t i = 0; i < files.size();) {
+        std::size_t j = i + 1;
+        while (j < files.size() && files[j].size == files[i].size && files[j].hash == files[i].hash) ++j;
+        runs.emplace_back(i, j);
+        i = j;
+    }
+    parallelFor(pool, runs.size(), 1, [&](std::size_t r) {
+        for (std::size_t i = runs[r].first; i < runs[r].second; ++i) {
+            Candidate& c = files[i];
+            c.copyOf = i;
+            for (std::size_t k = runs[r].first; k < i; ++k) {
+                const Candidate& first = files[k];
+                if (first.copyOf != k) continue;
+                const bool hardLink = first.node->dev == c.node->dev && first.node->ino == c.node->ino;
+                if (hardLink || sameContent(absolutePath(tree, first.rel).c_str(), absolutePath(tree, c.rel).c_str())) {
+                    c.copyOf = k;
+                    break;
+                }
+            }
+        }
+    });
+
+    std::vector<DupeGroup> groups;
+    for (const auto& [begin, end] : runs) {
+        for (std::size_t first = begin; first < end; ++first) {
+            if (files[first].copyOf != first) continue;
+            DupeGroup group;
+            group.size = files[first].size;
+            group.hash = files[first].hash;
+
+            std::vector<std::pair<std::string, const Node*>> members;
+            for (std::size_t j = first; j < end; ++j) {
+                if (files[j].copyOf == first) members.emplace_back(std::move(files[j].rel), files[j].node);
+            }
+            std::sort(members.begin(), members.end());
+
+            // Hard links to one inode do not waste space
+            std::set<std::pair<dev_t, ino_t>> inodes;
+            for (auto& [path, node] : members) {
+                struct stat st;
+                bool newInode = true;
+                if (::lstat(absolutePath(tree, path).c_str(), &st) == 0) {
+                    newInode = inodes.emplace(st.st_dev, st.st_ino).second;
+                }
+                group.extra.push_back(newInode && !group.paths.empty());
+                group.paths.push_back(std::move(path));
+                group.files.push_back(node);
+            }
+            group.copies = inodes.size();
+            if (group.copies > 1) groups.push_back(std::move(group));
+        }
+    }
+
+    std::sort(groups.begin(), groups.end(), [](const DupeGroup& a, const DupeGroup& b) {
+        return a.wasted() != b.wasted() ? a.wasted() > b.wasted() : a.paths < b.paths;
+    });
+    return groups;
+}
+
+namespace {
+
+struct FileMark {
+    std::size_t group;            // 1-based, as printed
+    bool extra;
+};
+
+struct DupesView {
+    std::unordered_map<const Node*, FileMark> files;
+    std::unordered_map<const Node*, std::uintmax_t> dirs;   // folders holding duplicates -> wasted bytes
+};
+
+// Fills view.dirs bottom-up; true if 'node' holds a duplicate
+bool markDirs(const Node& node, DupesView& view) {
+    bool kept = false;
+    std::uintmax_t wasted = 0;
+    for (const Node& child : node.children) {
+        auto file = view.files.find(&child);
+        if (file != view.files.end()) {
+            kept = true;
+            if (file->second.extra) wasted += *child.size;
+        } else if (child.isDir && markDirs(child, view)) {
+            kept = true;
+            wasted += view.dirs[&child];
+        }
+    }
+    if (kept) view.dirs[&node] = wasted;
+    return kept;
+}
+
+void appendWasted(std::string& out, std::uintmax_t wasted, bool color) {
+    if (wasted == 0) return;
+    out += ansi(color, kFgGray);
+    out += " (";
+    appendSize(out, wasted);
+    out += " wasted)";
+    out += ansi(color, kReset);
+}
+
+void writeDupesChildren(OutputWriter& out, const Node& dir, const DupesView& view, std::string& prefix, Theme theme,
+                        bool color) {
+    std::vector<const Node*> kept;
+    for (const Node& child : dir.children) {
+        if (view.files.count(&child) || view.dirs.count(&child)) kept.push_back(&child);
+    }
+
+    for (std::size_t i = 0; i < kept.size(); ++i) {
+        const Node& child = *kept[i];
+        bool isLast = (i == kept.size() - 1);
+
+        std::string& b = out.buffer();
+        b += ' ';
+        b += prefix;
+        b += branch(theme, isLast);
+        b += ansi(color, kReset);
+
+        auto file = view.files.find(&child);
+        if (file != view.files.end()) {
+            char digits[20];
+            b += child.name;
+            b += ansi(color, kFgCyan);
+            b += " [#";
+            b.append(digits, formatUnsignedTo(digits, file->second.group));
+            b += ']';
+            b += ansi(color, kReset);
+            appendSizeSuffix(b, child.size, color);
+            b += '\n';
+            out.commit();
+            continue;
+        }
+
+        b += ansi(color, kBold);
+        b += child.name;
+        b += '/';
+        b += ansi(color, kReset);
+        appendWasted(b, view.dirs.at(&child), color);
+        b += '\n';
+        out.commit();
+
+        std::size_t length = prefix.size();
+        prefix += vertical(theme, isLast);
+        writeDupesChildren(out, child, view, prefix, theme, color);
+        prefix.resize(length);
+    }
+}
+
+} // namespace
+
+void writeDupesTree(OutputWriter& out, const Tree& tree, const std::vector<DupeGroup>& groups, Theme theme,
+                    bool color) {
+    DupesView view;
+    std::size_t files = 0;
+    std::uintmax_t wasted = 0;
+    for (std::size_t g = 0; g < groups.size(); ++g) {
+        for (std::size_t i = 0; i < groups[g].files.size(); ++i) {
+            view.files[groups[g].files[i]] = FileMark{g + 1, groups[g].extra[i]};
+        }
+        files += groups[g].files.size();
+        wasted += groups[g].wasted();
+    }
+    markDirs(tree.root, view);
+
+    std::string& b = out.buffer();
+    b += "\n ";
+    b += ansi(color, kBold);
+    b += tree.root.name;
+    b += '/';
+    b += ansi(color, kReset);
+    appendWasted(b, wasted, color);
+    b += '\n';
+
+    std::string prefix;
+    writeDupesChildren(out, tree.root, view, prefix, theme, color);
+
+    char digits[20];
+    std::string& tail = out.buffer();
+    tail += "\n ";
+    tail.append(digits, formatUnsignedTo(digits, groups.size()));
+    tail += groups.size() == 1 ? " group, " : " groups, ";
+    tail.append(digits, formatUnsignedTo(digits, files));
+    tail += " files, ";
+    appendSize(tail, wasted);
+    tail += " wasted\n";
+    out.commit();
+}
+
+void writeDupesNdjson(OutputWriter& out, const std::vector<DupeGroup>& groups) {
+    char digits[20];
+    for (std::size_t g = 0; g < groups.size(); ++g) {
+        const DupeGroup& group = groups[g];
+        std::string& b = out.buffer();
+        b += "{\"group\":";
+        b.append(digits, formatUnsignedTo(digits, g + 1));
+        b += ",\"size\":";
+        b.append(digits, formatUnsignedTo(digits, group.size));
+        b += ",\"wasted\":";
+        b.append(digits, formatUnsignedTo(digits, group.wasted()));
+        b += ",\"hash\":\"";
+        appendHex64(b, group.hash);
+        b += "\",\"paths\":[";
+        for (std::size_t i = 0; i < group.paths.size(); ++i) {
+            if (i > 0) b += ',';
+            appendJsonString(b, group.paths[i]);
+        }
+        b += "]}\n";
+        out.commit();
+    }
+}
+
+} // namespace appletree
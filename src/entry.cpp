@@ -0,0 +1,32 @@
+#include "appletree/entry.h"
+
+#include <sys/stat.h>
+
+namespace appletree {
+
+EntryType entryTypeFromMode(mode_t mode) {
+    if (S_ISREG(mode))  return EntryType::file;
+    if (S_ISDIR(mode))  return EntryType::directory;
+    if (S_ISLNK(mode))  return EntryType::symlink;
+    if (S_ISFIFO(mode)) return EntryType::fifo;
+    if (S_ISSOCK(mode)) return EntryType::socket;
+    if (S_ISBLK(mode))  return EntryType::block;
+    if (S_ISCHR(mode))  return EntryType::character;
+    return EntryType::other;
+}
+
+const char* entryTypeName(EntryType type) {
+    switch (type) {
+        case EntryType::file:      return "file";
+        case EntryType::directory: return "directory";
+        case EntryType::symlink:   return "link";
+        case EntryType::fifo:      return "fifo";
+        case EntryType::socket:    return "socket";
+        case EntryType::block:     return "block";
+        case EntryType::character: return "char";
+        case EntryType::other:     break;
+    }
+    return "other";
+}
+
+} // namespace appletree
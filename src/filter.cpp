@@ -0,0 +1,178 @@
+#include "appletree/filter.h"
+
+#include <algorithm>
+
+#include "appletree/glob.h"
+
+namespace appletree {
+
+namespace {
+
+// "**/name" with a single-component 'name': basename match at any depth
+bool isAnywherePattern(std::string_view p) {
+    return p.size() > 3 && p.compare(0, 3, "**/") == 0 && p.find('/', 3) == std::string_view::npos;
+}
+
+// Drops trailing slashes ("src/" -> "src")
+std::string stripTrailingSlashes(std::string p) {
+    while (p.size() > 1 && p.back() == '/') p.pop_back();
+    return p;
+}
+
+Dfa compileGlobs(const std::vector<std::string>& globs) {
+    if (globs.empty()) return Dfa();
+    Nfa nfa;
+    for (std::size_t i = 0; i < globs.size(); ++i) addGlob(nfa, globs[i], static_cast<int>(i));
+    return Dfa(std::move(nfa));
+}
+
+} // namespace
+
+// ---- LiteralSet ----
+
+LiteralSet& LiteralSet::operator=(const LiteralSet& other) {
+    if (this == &other) return *this;
+    storage_.clear();
+    set_.clear();
+    lengths_.clear();
+    for (const auto& s : other.storage_) add(s);
+    return *this;
+}
+
+void LiteralSet::add(std::string s) {
+    if (contains(s)) return;
+    storage_.push_back(std::move(s));
+    const std::string& stored = storage_.back();
+    set_.insert(stored);
+    auto it = std::lower_bound(lengths_.begin(), lengths_.end(), stored.size());
+    if (it == lengths_.end() || *it != stored.size()) lengths_.insert(it, stored.size());
+}
+
+bool LiteralSet::containsPrefixOf(std::string_view s) const {
+    for (std::size_t len : lengths_) {
+        if (len > s.size()) break;
+        if (set_.count(s.substr(0, len))) return true;
+    }
+    return false;
+}
+
+bool LiteralSet::containsSuffixOf(std::string_view s) const {
+    for (std::size_t len : lengths_) {
+        if (len > s.size()) break;
+        if (set_.count(s.substr(s.size() - len))) return true;
+    }
+    return false;
+}
+
+bool LiteralSet::containsPathOrAncestor(std::string_view s) const {
+    if (set_.empty()) return false;
+    for (std::size_t pos = s.find('/'); pos != std::string_view::npos; pos = s.find('/', pos + 1)) {
+        if (set_.count(s.substr(0, pos))) return true;
+    }
+    return set_.count(s) != 0;
+}
+
+// ---- NameMatcher ----
+
+void NameMatcher::add(const std::string& pattern) {
+    if (!isGlob(pattern)) {
+        exact_.add(pattern);
+        return;
+    }
+    std::string_view p = pattern;
+    if (p.size() > 1 && p.front() == '*' && !isGlob(p.substr(1))) {
+        suffixes_.add(std::string(p.substr(1)));
+    } else if (p.size() > 1 && p.back() == '*' && !isGlob(p.substr(0, p.size() - 1))) {
+        prefixes_.add(std::string(p.substr(0, p.size() - 1)));
+    } else {
+        globs_.push_back(pattern);
+    }
+}
+
+void NameMatcher::compile() {
+    dfa_ = compileGlobs(globs_);
+}
+
+bool NameMatcher::empty() const {
+    return exact_.empty() && suffixes_.empty() && prefixes_.empty() && dfa_.empty();
+}
+
+bool NameMatcher::matches(std::string_view name) const {
+    return exact_.contains(name)
+        || suffixes_.containsSuffixOf(name)
+        || prefixes_.containsPrefixOf(name)
+        || (!dfa_.empty() && dfa_.run(name).acceptEnd >= 0);
+}
+
+// ---- ExcludeFilter ----
+
+void ExcludeFilter::add(const std::string& pattern) {
+    if (pattern == ".") {
+        hideDot_ = true;
+    } else if (pattern.find('/') == std::string::npos) {
+        names_.add(pattern);
+    } else if (isAnywherePattern(pattern)) {
+        names_.add(pattern.substr(3));
+    } else if (!isGlob(pattern)) {
+        paths_.add(stripTrailingSlashes(pattern));
+    } else {
+        pathGlobs_.push_back(stripTrailingSlashes(pattern));
+    }
+}
+
+void ExcludeFilter::compile() {
+    names_.compile();
+    pathDfa_ = compileGlobs(pathGlobs_);
+}
+
+bool ExcludeFilter::matches(std::string_view filename, std::string_view rel) const {
+    return names_.matches(filename)
+        || paths_.containsPathOrAncestor(rel)
+        || (!pathDfa_.empty() && pathDfa_.run(rel).acceptBoundary >= 0);
+}
+
+// ---- OnlyFilter ----
+
+void OnlyFilter::add(const std::string& pattern) {
+    if (isAnywherePattern(pattern)) {
+        anywhere_.add(pattern.substr(3));
+    } else if (!isGlob(pattern)) {
+        std::string path = stripTrailingSlashes(pattern);
+        for (std::size_t pos = path.find('/'); pos != std::string::npos; pos = path.find('/', pos + 1)) {
+            parents_.add(path.substr(0, pos));
+        }
+        paths_.add(std::move(path));
+    } else {
+        pathGlobs_.push_back(stripTrailingSlashes(pattern));
+    }
+}
+
+void OnlyFilter::compile() {
+    anywhere_.compile();
+    pathDfa_ = compileGlobs(pathGlobs_);
+}
+
+OnlyMatch OnlyFilter::match(std::string_view rel, bool isDir) const {
+    if (empty()) return OnlyMatch::match;
+    if (paths_.containsPathOrAncestor(rel) || parents_.contains(rel)) return OnlyMatch::match;
+
+    bool below = false;
+    if (!anywhere_.empty()) {
+        std::size_t start = 0;
+        for (std::size_t pos = rel.find('/'); ; pos = rel.find('/', start)) {
+            if (anywhere_.matches(rel.substr(start, pos - start))) return OnlyMatch::match;
+            if (pos == std::string_view::npos) break;
+            start = pos + 1;
+        }
+        below = isDir;
+    }
+
+    if (!pathDfa_.empty()) {
+        DfaRun r = pathDfa_.run(rel);
+        if (r.acceptBoundary >= 0) return OnlyMatch::match;
+        below = below || (isDir && r.liveBelow);
+    }
+    return below ? OnlyMatch::below : OnlyMatch::none;
+}
+
+} // namespace appletree
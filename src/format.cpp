@@ -0,0 +1,119 @@
+#include "appletree/format.h"
+
+namespace appletree {
+
+namespace {
+
+const char* const units[] = {" B"," KiB"," MiB"," GiB"," TiB"," PiB"," EiB"};
+
+char* writeUnit(char* out, int idx) {
+    for (const char* u = units[idx]; *u; ++u) *out++ = *u;
+    return out;
+}
+
+// Rounds 'value / 2^shift' to nearest, ties to even (printf semantics).
+std::uint64_t roundShift(std::uint64_t value, int shift) {
+    if (shift == 0) return value;
+    const std::uint64_t mask = (std::uint64_t(1) << shift) - 1;
+    const std::uint64_t half = std::uint64_t(1) << (shift - 1);
+    std::uint64_t q = value >> shift;
+    std::uint64_t r = value & mask;
+    if (r > half || (r == half && (q & 1))) ++q;
+    return q;
+}
+
+} // namespace
+
+char* formatUnsignedTo(char* out, std::uint64_t v) {
+    char tmp[20];
+    int n = 0;
+    do {
+        tmp[n++] = static_cast<char>('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (n) *out++ = tmp[--n];
+    return out;
+}
+
+char* formatSizeTo(char* out, std::uintmax_t bytes) {
+    std::uint64_t v = bytes;
+
+    // The previous implementation converted to double first; values above
+    // 2^53 lose their low bits there, so round them to 53 significant bits
+    // the same way (nearest, ties to even) before formatting.
+    if (v >> 53) {
+        int shift = 64 - __builtin_clzll(v) - 53;
+        std::uint64_t m = roundShift(v, shift);
+        if (m >> 53 && shift == 11) {
+            // Rounded up to exactly 2^64 = 16 EiB
+            *out++ = '1'; *out++ = '6';
+            return writeUnit(out, 6);
+        }
+        v = m << shift;
+    }
+
+    int idx = 0;
+    while (idx < 6 && (v >> (10 * (idx + 1))) != 0) ++idx;
+    const int shift = 10 * idx;
+
+    if (idx > 0 && (v >> shift) < 10) {
+        // One decimal: round(v * 10 / 2^shift) without overflowing v * 10
+        const std::uint64_t mask = (std::uint64_t(1) << shift) - 1;
+        std::uint64_t tenths = (v >> shift) * 10 + roundShift((v & mask) * 10, shift);
+        out = formatUnsignedTo(out, tenths / 10);
+        *out++ = '.';
+        *out++ = static_cast<char>('0' + tenths % 10);
+    } else {
+        out = formatUnsignedTo(out, roundShift(v, shift));
+    }
+
+    return writeUnit(out, idx);
+}
+
+void appendSize(std::string& out, std::uintmax_t bytes) {
+    char buf[kMaxSizeChars];
+    out.append(buf, formatSizeTo(buf, bytes));
+}
+
+void appendGrouped(std::string& out, std::uint64_t v) {
+    char digits[20];
+    const char* end = formatUnsignedTo(digits, v);
+    const std::size_t n = static_cast<std::size_t>(end - digits);
+    for (std::size_t i = 0; i < n; ++i) {
+        if (i > 0 && (n - i) % 3 == 0) out += ',';
+        out += digits[i];
+    }
+}
+
+void appendAge(std::string& out, std::int64_t seconds) {
+    const std::uint64_t s = seconds > 0 ? static_cast<std::uint64_t>(seconds) : 0;
+    const std::uint64_t days = s / 86400;
+    std::uint64_t v;
+    const char* unit;
+    if (s < 60)            { v = s;            unit = "s"; }
+    else if (s < 3600)     { v = s / 60;       unit = "m"; }
+    else if (days == 0)    { v = s / 3600;     unit = "h"; }
+    else if (days < 30)    { v = days;         unit = "d"; }
+    else if (days < 365)   { v = days / 30;    unit = "mo"; }
+    else                   { v = days / 365;   unit = "y"; }
+    char digits[20];
+    out.append(digits, formatUnsignedTo(digits, v));
+    out += unit;
+}
+
+std::string formatSize(std::uintmax_t bytes) {
+    char buf[kMaxSizeChars];
+    return std::string(buf, formatSizeTo(buf, bytes));
+}
+
+void appendHex64(std::string& out, std::uint64_t v) {
+    static const char digits[] = "0123456789abcdef";
+    char buf[16];
+    for (int i = 15; i >= 0; --i) {
+        buf[i] = digits[v & 0xF];
+        v >>= 4;
+    }
+    out.append(buf, sizeof(buf));
+}
+
+} // namespace appletree
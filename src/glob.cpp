@@ -0,0 +1,111 @@
+#include "appletree/glob.h"
+
+namespace appletree {
+
+namespace {
+
+std::bitset<256> notSlash() {
+    std::bitset<256> set;
+    set.set();
+    set.reset('/');
+    return set;
+}
+
+// Parses the class starting at p[i] == '['; returns false if unterminated
+bool parseClass(std::string_view p, std::size_t& i, std::bitset<256>& set) {
+    std::size_t j = i + 1;
+    bool negate = j < p.size() && (p[j] == '!' || p[j] == '^');
+    if (negate) ++j;
+
+    std::bitset<256> members;
+    bool first = true;
+    for (; j < p.size() && (first || p[j] != ']'); first = false) {
+        unsigned char lo = static_cast<unsigned char>(p[j]);
+        if (lo == '\\' && j + 1 < p.size()) lo = static_cast<unsigned char>(p[++j]);
+        ++j;
+        unsigned char hi = lo;
+        if (j + 1 < p.size() && p[j] == '-' && p[j + 1] != ']') {
+            hi = static_cast<unsigned char>(p[j + 1]);
+            j += 2;
+        }
+        for (int c = lo; c <= hi; ++c) members.set(c);
+    }
+    if (j >= p.size()) return false;
+
+    set = negate ? ~members : members;
+    set.reset('/');
+    i = j + 1;
+    return true;
+}
+
+} // namespace
+
+bool isGlob(std::string_view pattern) {
+    return pattern.find_first_of("*?[\\") != std::string_view::npos;
+}
+
+void addGlob(Nfa& nfa, std::string_view p, int id) {
+    int cur = nfa.add();
+    nfa.addStart(cur);
+
+    std::size_t i = 0;
+    while (i < p.size()) {
+        const bool componentStart = i == 0 || p[i - 1] == '/';
+        if (componentStart && p.compare(i, 2, "**") == 0 && (i + 2 == p.size() || p[i + 2] == '/')) {
+            if (i + 2 == p.size()) {
+                // Trailing '**': everything below, across '/'
+                int end = nfa.add();
+                nfa[cur].bytes.set();
+                nfa[cur].next = cur;
+                nfa[cur].eps.push_back(end);
+                cur = end;
+                i += 2;
+            } else {
+                // '**/': zero or more "component/" groups
+                int body = nfa.add();
+                int slash = nfa.add();
+                int exit = nfa.add();
+                nfa[cur].eps = {body, exit};
+                nfa[body].bytes = notSlash();
+                nfa[body].next = body;
+                nfa[body].eps.push_back(slash);
+                nfa[slash].bytes.set('/');
+                nfa[slash].next = cur;
+                cur = exit;
+                i += 3;
+            }
+            continue;
+        }
+
+        if (p[i] == '*') {
+            int n = nfa.add();
+            nfa[cur].bytes = notSlash();
+            nfa[cur].next = cur;
+            nfa[cur].eps.push_back(n);
+            cur = n;
+            while (i < p.size() && p[i] == '*') ++i;
+            continue;
+        }
+
+        std::bitset<256> set;
+        if (p[i] == '?') {
+            set = notSlash();
+            ++i;
+        } else if (p[i] == '[' && parseClass(p, i, set)) {
+            // 'i' already advanced past ']'
+        } else if (p[i] == '\\' && i + 1 < p.size()) {
+            set.set(static_cast<unsigned char>(p[i + 1]));
+            i += 2;
+        } else {
+            set.set(static_cast<unsigned char>(p[i]));
+            ++i;
+        }
+        int n = nfa.add();
+        nfa[cur].bytes = set;
+        nfa[cur].next = n;
+        cur = n;
+    }
+    nfa[cur].accept = id;
+}
+
+} // namespace appletree
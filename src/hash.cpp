@@ -0,0 +1,219 @@
+#include "appletree/hash.h"
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace appletree {
+
+namespace {
+
+constexpr std::uint64_t P1 = 0x9E3779B185EBCA87ULL;
+constexpr std::uint64_t P2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr std::uint64_t P3 = 0x165667B19E3779F9ULL;
+constexpr std::uint64_t P4 = 0x85EBCA77C2B2AE63ULL;
+constexpr std::uint64_t P5 = 0x27D4EB2F165667C5ULL;
+
+constexpr std::size_t kReadBlock = 1 << 20;
+
+inline std::uint64_t rotl(std::uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline std::uint64_t read64(const unsigned char* p) {
+    std::uint64_t v;
+    std::memcpy(&v, p, 8);
+    return v;   // little-endian hosts (Linux x86-64/arm64, macOS)
+}
+
+inline std::uint32_t read32(const unsigned char* p) {
+    std::uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+inline std::uint64_t xxRound(std::uint64_t acc, std::uint64_t input) {
+    acc += input * P2;
+    acc = rotl(acc, 31);
+    return acc * P1;
+}
+
+inline std::uint64_t mergeRound(std::uint64_t acc, std::uint64_t v) {
+    acc ^= xxRound(0, v);
+    return acc * P1 + P4;
+}
+
+// Reads exactly 'len' bytes at 'offset' unless the file ends first
+ssize_t preadFull(int fd, unsigned char* buf, std::size_t len, off_t offset) {
+    std::size_t done = 0;
+    while (done < len) {
+        ssize_t n = ::pread(fd, buf + done, len - done, offset + static_cast<off_t>(done));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) break;
+        done += static_cast<std::size_t>(n);
+    }
+    return static_cast<ssize_t>(done);
+}
+
+} // namespace
+
+Xxh64::Xxh64(std::uint64_t seed) : seed_(seed) {
+    v_[0] = seed + P1 + P2;
+    v_[1] = seed + P2;
+    v_[2] = seed;
+    v_[3] = seed - P1;
+}
+
+void Xxh64::update(const void* data, std::size_t len) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + len;
+    total_ += len;
+
+    if (bufLen_ + len < 32) {
+        std::memcpy(buf_ + bufLen_, p, len);
+        bufLen_ += len;
+        return;
+    }
+    if (bufLen_ > 0) {
+        std::size_t fill = 32 - bufLen_;
+        std::memcpy(buf_ + bufLen_, p, fill);
+        for (int i = 0; i < 4; ++i) v_[i] = xxRound(v_[i], read64(buf_ + 8 * i));
+        p += fill;
+        bufLen_ = 0;
+    }
+    for (; p + 32 <= end; p += 32) {
+        v_[0] = xxRound(v_[0], read64(p));
+        v_[1] = xxRound(v_[1], read64(p + 8));
+        v_[2] = xxRound(v_[2], read64(p + 16));
+        v_[3] = xxRound(v_[3], read64(p + 24));
+    }
+    bufLen_ = static_cast<std::size_t>(end - p);
+    std::memcpy(buf_, p, bufLen_);
+}
+
+std::uint64_t Xxh64::digest() const {
+    std::uint64_t h;
+    if (total_ >= 32) {
+        h = rotl(v_[0], 1) + rotl(v_[1], 7) + rotl(v_[2], 12) + rotl(v_[3], 18);
+        for (int i = 0; i < 4; ++i) h = mergeRound(h, v_[i]);
+    } else {
+        h = seed_ + P5;
+    }
+    h += total_;
+
+    const unsigned char* p = buf_;
+    const unsigned char* end = buf_ + bufLen_;
+    for (; p + 8 <= end; p += 8) {
+        h ^= xxRound(0, read64(p));
+        h = rotl(h, 27) * P1 + P4;
+    }
+    if (p + 4 <= end) {
+        h ^= static_cast<std::uint64_t>(read32(p)) * P1;
+        h = rotl(h, 23) * P2 + P3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        h ^= (*p) * P5;
+        h = rotl(h, 11) * P1;
+    }
+
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
+
+std::uint64_t xxh64(const void* data, std::size_t len, std::uint64_t seed) {
+    Xxh64 h(seed);
+    h.update(data, len);
+    return h.digest();
+}
+
+bool hashFile(const char* path, std::uint64_t& hash, std::uint64_t& size) {
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+#ifdef POSIX_FADV_SEQUENTIAL
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    // One read block per thread: memory stays bounded by the worker count
+    thread_local std::unique_ptr<unsigned char[]> buf(new unsigned char[kReadBlock]);
+    Xxh64 h;
+    size = 0;
+    bool ok = true;
+    for (;;) {
+        ssize_t n = preadFull(fd, buf.get(), kReadBlock, static_cast<off_t>(size));
+        if (n < 0) {
+            ok = false;
+            break;
+        }
+        if (n == 0) break;
+        h.update(buf.get(), static_cast<std::size_t>(n));
+        size += static_cast<std::uint64_t>(n);
+    }
+    ::close(fd);
+    hash = h.digest();
+    return ok;
+}
+
+bool hashFileEdges(const char* path, std::uint64_t size, std::size_t edge, std::uint64_t& hash) {
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    std::unique_ptr<unsigned char[]> buf(new unsigned char[2 * edge]);
+    std::size_t len;
+    bool ok;
+    if (size <= 2 * edge) {
+        ssize_t n = preadFull(fd, buf.get(), static_cast<std::size_t>(size), 0);
+        ok = n >= 0;
+        len = ok ? static_cast<std::size_t>(n) : 0;
+    } else {
+        ssize_t head = preadFull(fd, buf.get(), edge, 0);
+        ssize_t tail = preadFull(fd, buf.get() + edge, edge, static_cast<off_t>(size - edge));
+        ok = head == static_cast<ssize_t>(edge) && tail == static_cast<ssize_t>(edge);
+        len = 2 * edge;
+    }
+    ::close(fd);
+    hash = xxh64(buf.get(), len, size);
+    return ok;
+}
+
+bool sameContent(const char* a, const char* b) {
+    int fa = ::open(a, O_RDONLY | O_CLOEXEC);
+    if (fa < 0) return false;
+    int fb = ::open(b, O_RDONLY | O_CLOEXEC);
+    if (fb < 0) {
+        ::close(fa);
+        return false;
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    ::posix_fadvise(fa, 0, 0, POSIX_FADV_SEQUENTIAL);
+    ::posix_fadvise(fb, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    // Half a read block per file and thread, like hashFile()
+    constexpr std::size_t kHalf = kReadBlock / 2;
+    thread_local std::unique_ptr<unsigned char[]> buf(new unsigned char[kReadBlock]);
+    bool same = true;
+    for (off_t offset = 0;; offset += static_cast<off_t>(kHalf)) {
+        ssize_t na = preadFull(fa, buf.get(), kHalf, offset);
+        ssize_t nb = preadFull(fb, buf.get() + kHalf, kHalf, offset);
+        if (na < 0 || na != nb || std::memcmp(buf.get(), buf.get() + kHalf, static_cast<std::size_t>(na)) != 0) {
+            same = false;
+            break;
+        }
+        if (na < static_cast<ssize_t>(kHalf)) break;
+    }
+    ::close(fa);
+    ::close(fb);
+    return same;
+}
+
+} // namespace appletree
@@ -0,0 +1,205 @@
+#include "appletree/ignore.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include "appletree/glob.h"
+
+namespace appletree {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string readFile(const fs::path& path, bool& ok) {
+    std::ifstream in(path, std::ios::binary);
+    ok = static_cast<bool>(in);
+    if (!ok) return {};
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+std::string expandHome(std::string p) {
+    if (p.size() >= 1 && p[0] == '~') {
+        if (const char* home = std::getenv("HOME")) p = home + p.substr(1);
+    }
+    return p;
+}
+
+std::string trim(std::string s) {
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) s.pop_back();
+    std::size_t i = 0;
+    while (i < s.size() && (s[i] == ' ' || s[i] == '\t')) ++i;
+    return s.substr(i);
+}
+
+// core.excludesFile from ~/.gitconfig, else git's default location
+fs::path globalExcludesFile() {
+    if (const char* home = std::getenv("HOME")) {
+        bool ok = false;
+        std::istringstream config(readFile(fs::path(home) / ".gitconfig", ok));
+        std::string line;
+        bool inCore = false;
+        while (std::getline(config, line)) {
+            line = trim(line);
+            if (!line.empty() && line[0] == '[') {
+                inCore = line.rfind("[core]", 0) == 0;
+                continue;
+            }
+            if (!inCore) continue;
+            auto eq = line.find('=');
+            if (eq == std::string::npos) continue;
+            std::string key = trim(line.substr(0, eq));
+            for (char& c : key) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            if (key == "excludesfile") return expandHome(trim(line.substr(eq + 1)));
+        }
+    }
+    if (const char* xdg = std::getenv("XDG_CONFIG_HOME"); xdg && *xdg) return fs::path(xdg) / "git" / "ignore";
+    if (const char* home = std::getenv("HOME")) return fs::path(home) / ".config" / "git" / "ignore";
+    return {};
+}
+
+std::shared_ptr<const IgnoreRules> loadRules(const fs::path& path) {
+    auto rules = std::make_shared<IgnoreRules>();
+    if (!rules->load(path)) return nullptr;
+    return rules;
+}
+
+} // namespace
+
+// ---- IgnoreRules ----
+
+bool IgnoreRules::load(const fs::path& path) {
+    bool ok = false;
+    std::string text = readFile(path, ok);
+    if (!ok) return false;
+    parse(text);
+    return !empty();
+}
+
+void IgnoreRules::parse(std::string_view text) {
+    Nfa all, filesOnly;
+    bool anyFileRule = false;
+
+    std::size_t pos = 0;
+    while (pos < text.size()) {
+        std::size_t eol = text.find('\n', pos);
+        if (eol == std::string_view::npos) eol = text.size();
+        std::string line(text.substr(pos, eol - pos));
+        pos = eol + 1;
+
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        // Trailing spaces are dropped unless escaped with a backslash
+        while (!line.empty() && line.back() == ' ' && !(line.size() > 1 && line[line.size() - 2] == '\\')) {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') continue;
+
+        Rule rule{false, false};
+        if (line[0] == '!') {
+            rule.negate = true;
+            line.erase(0, 1);
+        }
+        if (!line.empty() && line.back() == '/') {
+            rule.dirOnly = true;
+            while (!line.empty() && line.back() == '/') line.pop_back();
+        }
+        if (line.empty()) continue;
+
+        // A slash anywhere but at the end anchors the pattern to this directory
+        std::string pattern;
+        if (line.find('/') != std::string::npos) {
+            pattern = line[0] == '/' ? line.substr(1) : line;
+        } else {
+            pattern = "**/" + line;
+        }
+
+        const int id = static_cast<int>(rules_.size());
+        rules_.push_back(rule);
+        addGlob(all, pattern, id);
+        if (!rule.dirOnly) {
+            addGlob(filesOnly, pattern, id);
+            anyFileRule = true;
+        }
+    }
+
+    all_ = rules_.empty() ? Dfa() : Dfa(std::move(all));
+    filesOnly_ = anyFileRule ? Dfa(std::move(filesOnly)) : Dfa();
+}
+
+IgnoreRules::Match IgnoreRules::match(std::string_view rel, bool isDir) const {
+    const Dfa& dfa = isDir ? all_ : filesOnly_;
+    if (dfa.empty()) return Match::none;
+    int id = dfa.run(rel).acceptEnd;
+    if (id < 0) return Match::none;
+    return rules_[id].negate ? Match::included : Match::ignored;
+}
+
+// ---- IgnoreStack ----
+
+void IgnoreStack::init(const fs::path& root) {
+    frames_.clear();
+    const fs::path start = fs::absolute(root).lexically_normal();
+
+    // Repository root: nearest ancestor (or 'root' itself) containing .git
+    fs::path repo;
+    std::error_code ec;
+    for (fs::path p = start; ; p = p.parent_path()) {
+        if (fs::exists(p / ".git", ec)) {
+            repo = p;
+            break;
+        }
+        if (p == p.parent_path()) break;
+    }
+    if (repo.empty()) repo = start;
+
+    // Lowest precedence first
+    frames_.push_back({"", loadRules(globalExcludesFile())});
+    frames_.push_back({"", loadRules(repo / ".git" / "info" / "exclude")});
+    frames_.push_back({"", loadRules(repo / ".gitignore")});
+
+    const fs::path rel = start.lexically_relative(repo);
+    fs::path dir = repo;
+    std::string base;
+    for (const auto& part : rel) {
+        if (part.empty() || part == ".") continue;
+        dir /= part;
+        base = base.empty() ? part.string() : base + "/" + part.string();
+        frames_.push_back({base, loadRules(dir / ".gitignore")});
+    }
+}
+
+void IgnoreStack::push(const fs::path& dir) {
+    const std::string& parent = frames_.empty() ? std::string() : frames_.back().base;
+    std::string name = dir.filename().string();
+    std::string base = parent.empty() ? name : parent + "/" + name;
+    frames_.push_back({std::move(base), loadRules(dir / ".gitignore")});
+}
+
+bool IgnoreStack::isIgnored(std::string_view name, bool isDir) const {
+    if (name == ".git") return true;
+    if (frames_.empty()) return false;
+
+    // Path of the entry relative to the repository root
+    const std::string& dir = frames_.back().base;
+    scratch_.assign(dir);
+    if (!scratch_.empty()) scratch_ += '/';
+    scratch_.append(name.data(), name.size());
+
+    for (auto it = frames_.rbegin(); it != frames_.rend(); ++it) {
+        if (!it->rules) continue;
+        std::string_view rel = scratch_;
+        if (!it->base.empty()) rel.remove_prefix(it->base.size() + 1);
+        switch (it->rules->match(rel, isDir)) {
+            case IgnoreRules::Match::ignored:  return true;
+            case IgnoreRules::Match::included: return false;
+            case IgnoreRules::Match::none:     break;
+        }
+    }
+    return false;
+}
+
+} // namespace appletree
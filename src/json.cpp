@@ -0,0 +1,209 @@
+#include "appletree/json.h"
+
+#include "appletree/format.h"
+
+namespace appletree {
+
+namespace {
+
+// 1 for bytes that need escaping inside a JSON string, or a look whether
+// they start valid UTF-8 (0x80 and up)
+struct EscapeTable {
+    bool needs[256] = {};
+    constexpr EscapeTable() {
+        for (int c = 0; c < 0x20; ++c) needs[c] = true;
+        for (int c = 0x80; c < 0x100; ++c) needs[c] = true;
+        needs[static_cast<unsigned char>('"')] = true;
+        needs[static_cast<unsigned char>('\\')] = true;
+    }
+};
+constexpr EscapeTable escapeTable;
+
+void appendEscaped(std::string& out, unsigned char c) {
+    static const char hex[] = "0123456789abcdef";
+    switch (c) {
+        case '"':  out += "\\\""; return;
+        case '\\': out += "\\\\"; return;
+        case '\n': out += "\\n"; return;
+        case '\r': out += "\\r"; return;
+        case '\t': out += "\\t"; return;
+        case '\b': out += "\\b"; return;
+        case '\f': out += "\\f"; return;
+        default: {
+            char u[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+            out.append(u, sizeof(u));
+        }
+    }
+}
+
+// Length of the well-formed UTF-8 sequence at 'p' (lead byte 0x80 or up),
+// or 0: stray continuation bytes, overlong forms, surrogates, code points
+// above U+10FFFF and truncated sequences are all rejected
+std::size_t utf8Length(const unsigned char* p, const unsigned char* end) {
+    std::size_t length;
+    unsigned char low = 0x80, high = 0xBF;   // range of the second byte
+    if (p[0] >= 0xC2 && p[0] <= 0xDF) length = 2;
+    else if (p[0] >= 0xE0 && p[0] <= 0xEF) length = 3;
+    else if (p[0] >= 0xF0 && p[0] <= 0xF4) length = 4;
+    else return 0;
+    if (p[0] == 0xE0) low = 0xA0;
+    else if (p[0] == 0xED) high = 0x9F;
+    else if (p[0] == 0xF0) low = 0x90;
+    else if (p[0] == 0xF4) high = 0x8F;
+
+    if (static_cast<std::size_t>(end - p) < length) return 0;
+    if (p[1] < low || p[1] > high) return 0;
+    for (std::size_t i = 2; i < length; ++i) {
+        if (p[i] < 0x80 || p[i] > 0xBF) return 0;
+    }
+    return length;
+}
+
+void appendNumber(std::string& out, std::uint64_t v) {
+    char buf[20];
+    out.append(buf, formatUnsignedTo(buf, v));
+}
+
+struct TreeCounts {
+    std::uint64_t directories = 0;
+    std::uint64_t files = 0;
+};
+
+// Appends 'v' with a leading '-' if negative
+void appendSigned(std::string& out, std::int64_t v) {
+    if (v < 0) {
+        out += '-';
+        appendNumber(out, static_cast<std::uint64_t>(-(v + 1)) + 1);
+    } else {
+        appendNumber(out, static_cast<std::uint64_t>(v));
+    }
+}
+
+void writeJsonNode(OutputWriter& out, const Node& node, std::size_t depth, TreeCounts& counts, bool withCounts,
+                   bool withNewest) {
+    std::string& b = out.buffer();
+    b.append(2 * (depth + 1), ' ');
+    b += "{\"type\":\"";
+    b += entryTypeName(node.type);
+    b += "\",\"name\":";
+    appendJsonString(b, node.name);
+    if (node.size) {
+        b += ",\"size\":";
+        appendNumber(b, *node.size);
+    }
+    if (node.hash) {
+        b += ",\"hash\":\"";
+        appendHex64(b, *node.hash);
+        b += '"';
+    }
+    if (node.unscanned) b += ",\"unscanned\":true";
+    else if (node.isDir) {
+        if (withCounts) appendJsonCounts(b, node.files, node.folders);
+        if (withNewest) appendJsonNewest(b, node.newest);
+    }
+    if (!node.isDir) {
+        b += '}';
+        return;
+    }
+
+    b += ",\"contents\":[";
+    if (!node.children.empty()) {
+        b += '\n';
+        for (std::size_t i = 0; i < node.children.size(); ++i) {
+            const Node& child = node.children[i];
+            if (child.type == EntryType::directory) ++counts.directories;
+            else ++counts.files;
+
+            writeJsonNode(out, child, depth + 1, counts, withCounts, withNewest);
+            if (i + 1 < node.children.size()) out.buffer() += ',';
+            out.buffer() += '\n';
+            out.commit();
+        }
+        out.buffer().append(2 * (depth + 1), ' ');
+    }
+    out.buffer() += "]}";
+}
+
+} // namespace
+
+void appendJsonString(std::string& out, std::string_view s) {
+    out += '"';
+    const char* p = s.data();
+    const char* end = p + s.size();
+    const char* run = p;
+    while (p != end) {
+        unsigned char c = static_cast<unsigned char>(*p);
+        if (!escapeTable.needs[c]) {
+            ++p;
+            continue;
+        }
+        if (c >= 0x80) {
+            const std::size_t length = utf8Length(reinterpret_cast<const unsigned char*>(p),
+                                                  reinterpret_cast<const unsigned char*>(end));
+            if (length > 0) {
+                p += length;
+                continue;
+            }
+        }
+        out.append(run, p);
+        if (c >= 0x80) out += "\\ufffd";
+        else appendEscaped(out, c);
+        run = ++p;
+    }
+    out.append(run, end);
+    out += '"';
+}
+
+void appendJsonCounts(std::string& out, std::uint64_t files, std::uint64_t folders) {
+    out += ",\"files\":";
+    appendNumber(out, files);
+    out += ",\"folders\":";
+    appendNumber(out, folders);
+}
+
+void appendJsonNewest(std::string& out, std::int64_t newest) {
+    out += ",\"newest\":";
+    appendSigned(out, newest);
+}
+
+void appendNdjsonRecord(std::string& out, std::string_view path, EntryType type,
+                        std::size_t depth, std::optional<std::uintmax_t> size,
+                        std::int64_t mtime, std::optional<std::uint64_t> hash,
+                        bool unscanned, std::string_view extra) {
+    out += "{\"path\":";
+    appendJsonString(out, path);
+    out += ",\"type\":\"";
+    out += entryTypeName(type);
+    out += "\",\"depth\":";
+    appendNumber(out, depth);
+    if (size) {
+        out += ",\"size\":";
+        appendNumber(out, *size);
+    }
+    out += ",\"mtime\":";
+    appendSigned(out, mtime);
+    if (hash) {
+        out += ",\"hash\":\"";
+        appendHex64(out, *hash);
+        out += '"';
+    }
+    if (unscanned) out += ",\"unscanned\":true";
+    out += extra;
+    out += "}\n";
+}
+
+void writeJsonTree(OutputWriter& out, const Node& root, bool withCounts, bool withNewest) {
+    TreeCounts counts;
+    out.buffer() += "[\n";
+    writeJsonNode(out, root, 0, counts, withCounts, withNewest);
+
+    std::string& b = out.buffer();
+    b += "\n,\n  {\"type\":\"report\",\"directories\":";
+    appendNumber(b, counts.directories);
+    b += ",\"files\":";
+    appendNumber(b, counts.files);
+    b += "}\n]\n";
+    out.commit();
+}
+
+} // namespace appletree
@@ -0,0 +1,123 @@
+#include "appletree/merkle.h"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <unistd.h>
+
+#include "appletree/hash.h"
+
+namespace appletree {
+
+std::size_t HashCache::KeyHash::operator()(const Key& k) const {
+    std::uint64_t h = k.ino * 0x9E3779B97F4A7C15ULL;
+    h ^= (k.size + 0x632BE59BD9B4E019ULL) * 0xC2B2AE3D27D4EB4FULL;
+    h ^= static_cast<std::uint64_t>(k.mtimeNs) * 0x165667B19E3779F9ULL;
+    h ^= (k.dev ^ static_cast<std::uint64_t>(k.ctimeNs)) * 0x27D4EB2F165667C5ULL;
+    return static_cast<std::size_t>(h ^ (h >> 32));
+}
+
+void HashCache::add(const Node& node) {
+    if (node.type == EntryType::file && node.hash && node.size) map_[Key(node)] = *node.hash;
+    for (const Node& child : node.children) add(child);
+}
+
+bool HashCache::find(const Node& file, std::uint64_t& hash) const {
+    auto it = map_.find(Key(file));
+    if (it == map_.end()) return false;
+    hash = it->second;
+    return true;
+}
+
+namespace {
+
+struct Pending {
+    Node* node;
+    std::string path;
+};
+
+// Resolves cache hits and link targets, queues the files that must be read
+void collect(Node& node, std::string& path, const HashCache& cache, std::vector<Pending>& pending,
+             HashStats& stats) {
+    std::size_t length = path.size();
+    for (Node& child : node.children) {
+        path += '/';
+        path += child.name;
+
+        if (child.type == EntryType::file) {
+            std::uint64_t hash;
+            if (cache.find(child, hash)) {
+                child.hash = hash;
+                ++stats.cached;
+            } else {
+                pending.push_back(Pending{&child, path});
+            }
+        } else if (child.type == EntryType::symlink) {
+            char target[4096];
+            ssize_t n = ::readlink(path.c_str(), target, sizeof(target));
+            child.hash = xxh64(target, n > 0 ? static_cast<std::size_t>(n) : 0, 1);
+        } else if (child.type == EntryType::directory) {
+            collect(child, path, cache, pending, stats);
+        } else {
+            child.hash = xxh64(nullptr, 0, 2 + static_cast<std::uint64_t>(child.type));
+        }
+        path.resize(length);
+    }
+}
+
+// Merkle hash of a directory from its already hashed children
+void combine(Node& node) {
+    Xxh64 h(3);
+    for (Node& child : node.children) {
+        if (child.type == EntryType::directory) combine(child);
+
+        unsigned char fields[9];
+        std::uint64_t hash = child.hash.value_or(0);
+        fields[0] = static_cast<unsigned char>(child.type);
+        for (int i = 0; i < 8; ++i) fields[1 + i] = static_cast<unsigned char>(hash >> (8 * i));
+
+        h.update(child.name.data(), child.name.size());
+        h.update("", 1);   // NUL ends the name: ("ab", "c") != ("a", "bc")
+        h.update(fields, sizeof(fields));
+    }
+    node.hash = h.digest();
+}
+
+} // namespace
+
+HashStats hashTree(Tree& tree, const HashCache& cache, ThreadPool& pool) {
+    HashStats stats;
+    Node& root = tree.root;
+
+    if (root.type == EntryType::file) {
+        std::uint64_t hash, bytes;
+        if (hashFile(tree.path.c_str(), hash, bytes)) root.hash = hash;
+        return stats;
+    }
+
+    std::vector<Pending> pending;
+    std::string path = tree.path.string();
+    collect(root, path, cache, pending, stats);
+
+    // Small batches keep the queue short and the workers busy
+    std::atomic<std::size_t> failed{0};
+    constexpr std::size_t kBatch = 16;
+    for (std::size_t begin = 0; begin < pending.size(); begin += kBatch) {
+        std::size_t end = std::min(pending.size(), begin + kBatch);
+        pool.submit([&pending, &failed, begin, end] {
+            for (std::size_t i = begin; i < end; ++i) {
+                std::uint64_t hash, bytes;
+                if (hashFile(pending[i].path.c_str(), hash, bytes)) pending[i].node->hash = hash;
+                else ++failed;
+            }
+        });
+    }
+    pool.wait();
+
+    stats.hashed = pending.size() - failed;
+    stats.failed = failed;
+    if (root.isDir) combine(root);
+    return stats;
+}
+
+} // namespace appletree
@@ -0,0 +1,97 @@
+#include "appletree/predicate.h"
+
+#include <cctype>
+#include <cstdlib>
+
+namespace appletree {
+
+namespace {
+
+std::uint32_t typeBit(EntryType type) {
+    return 1u << static_cast<unsigned>(type);
+}
+
+} // namespace
+
+bool Predicates::matches(const Node& node) const {
+    if (types != 0 && !(types & typeBit(node.type))) return false;
+    if (newerThan && !(node.mtime > *newerThan)) return false;
+    if (olderThan && !(node.mtime < *olderThan)) return false;
+    if (minSize && !(node.type == EntryType::file && node.size && *node.size >= *minSize)) return false;
+    if (!extensions.empty()
+        && (node.type == EntryType::directory || !extensions.containsSuffixOf(node.name))) return false;
+    return true;
+}
+
+bool parseSizeArg(const std::string& s, std::uintmax_t& bytes) {
+    if (s.empty() || !std::isdigit(static_cast<unsigned char>(s[0]))) return false;
+    char* end = nullptr;
+    double value = std::strtod(s.c_str(), &end);
+    std::string unit(end);
+    for (char& c : unit) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    if (unit.size() > 1 && unit.back() == 'B') unit.pop_back();   // "MB", "KiB"
+    if (unit.size() > 1 && unit.back() == 'I') unit.pop_back();
+
+    static const std::string units = "BKMGTPE";
+    int shift = 0;
+    if (!unit.empty()) {
+        if (unit.size() != 1 || units.find(unit[0]) == std::string::npos) return false;
+        shift = 10 * static_cast<int>(units.find(unit[0]));
+    }
+    value *= static_cast<double>(std::uintmax_t(1) << shift);
+    if (value < 0 || value >= 18446744073709551615.0) return false;
+    bytes = static_cast<std::uintmax_t>(value);
+    return true;
+}
+
+bool parseAgeArg(const std::string& s, std::int64_t& seconds) {
+    if (s.empty() || !std::isdigit(static_cast<unsigned char>(s[0]))) return false;
+    char* end = nullptr;
+    double value = std::strtod(s.c_str(), &end);
+    std::string unit(end);
+
+    double scale;
+    if (unit.empty() || unit == "d") scale = 86400;
+    else if (unit == "s") scale = 1;
+    else if (unit == "m") scale = 60;
+    else if (unit == "h") scale = 3600;
+    else if (unit == "w") scale = 7 * 86400;
+    else if (unit == "y") scale = 365 * 86400;
+    else return false;
+
+    seconds = static_cast<std::int64_t>(value * scale);
+    return true;
+}
+
+bool parseTypeArg(const std::string& s, std::uint32_t& mask) {
+    std::uint32_t result = 0;
+    for (char c : s) {
+        switch (c) {
+            case 'f': result |= typeBit(EntryType::file); break;
+            case 'd': result |= typeBit(EntryType::directory); break;
+            case 'l': result |= typeBit(EntryType::symlink); break;
+            case 'p': result |= typeBit(EntryType::fifo); break;
+            case 's': result |= typeBit(EntryType::socket); break;
+            case 'b': result |= typeBit(EntryType::block); break;
+            case 'c': result |= typeBit(EntryType::character); break;
+            case ',': break;
+            default: return false;
+        }
+    }
+    if (result == 0) return false;
+    mask |= result;
+    return true;
+}
+
+void addExtensions(const std::string& s, LiteralSet& extensions) {
+    std::size_t start = 0;
+    while (start <= s.size()) {
+        std::size_t comma = s.find(',', start);
+        if (comma == std::string::npos) comma = s.size();
+        std::string ext = s.substr(start, comma - start);
+        if (!ext.empty()) extensions.add(ext[0] == '.' ? ext : "." + ext);
+        start = comma + 1;
+    }
+}
+
+} // namespace appletree
@@ -0,0 +1,209 @@
+#include "appletree/progressive.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sys/ioctl.h>
+
+#include "appletree/format.h"
+#include "appletree/scan.h"
+
+namespace appletree {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// What the text renderer ends a line with when there is no size (and no
+// hash, counts or age, which --progressive does not take)
+const std::string kNoSize = std::string(kFgGray) + kReset + "\n";
+constexpr std::string_view kNoSizePlain = "\n";
+
+void appendCursorMove(std::string& out, std::size_t rows, char direction) {
+    char digits[20];
+    out += "\033[";
+    out.append(digits, formatUnsignedTo(digits, rows));
+    out += direction;
+}
+
+} // namespace
+
+ProgressiveRenderer::ProgressiveRenderer(OutputWriter& out, const RenderOptions& options, const Scanner& scanner,
+                                         const fs::path& root, bool terminal)
+    : out_(out), text_(makeRenderer(lines_, options)), scanner_(scanner), root_(root), terminal_(terminal), color_(options.color),
+      noSize_(color_ ? kNoSize : kNoSizePlain) {
+    if (terminal_) {
+        winsize ws{};
+        if (::ioctl(1, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0) rows_ = ws.ws_row;
+        // One row per line, or the cursor moves below would miss
+        out_.buffer() += "\033[?7l";
+    }
+}
+
+ProgressiveRenderer::~ProgressiveRenderer() {
+    if (terminal_ && !finished_) {
+        out_.buffer() += "\033[?7h";
+        out_.flush();
+    }
+}
+
+void ProgressiveRenderer::entry(const EntryView& entry, std::size_t depth, bool isLast) {
+    // Pre-order: the folders at this depth or deeper are listed completely
+    close(depth);
+
+    std::string& line = lines_.buffer();
+    line.clear();
+    text_->entry(entry, depth, isLast);
+    const std::size_t newlines = static_cast<std::size_t>(std::count(line.begin(), line.end(), '\n'));
+
+    std::string& buf = out_.buffer();
+    // Decided from the entry, not from the text: the line is its head
+    // followed by noSize_
+    const bool pending = entry.isDir && !entry.size && !entry.unscanned;
+    if (pending) {
+        // The root line comes after a blank one
+        const std::size_t start = depth == 0 ? 1 : 0;
+        const std::size_t end = line.size() - noSize_.size();
+        buf.append(line, 0, start);
+
+        Folder folder;
+        folder.line = lineCount_ + newlines - 1;
+        folder.head.assign(line, start, end - start);
+        folder.path.assign(entry.path);
+        folder.dir = depth == 0 ? root_ : root_ / fs::path(std::string(entry.path));
+        folder.depth = depth;
+        folder.parent = kNoParent;
+        // Part of the parent's size, unless it is a link to a folder
+        if (!open_.empty() && entry.type == EntryType::directory && folders_[open_.back()].depth + 1 == depth) {
+            Folder& parent = folders_[open_.back()];
+            parent.listed.emplace_back(entry.name);
+            ++parent.pending;
+            folder.parent = open_.back();
+        }
+        open_.push_back(folders_.size());
+        folders_.push_back(std::move(folder));
+
+        buf += folders_.back().head;
+        if (terminal_) {
+            buf += ansi(color_, kFgGray);
+            buf += " (…)";
+            buf += ansi(color_, kReset);
+            buf += '\n';
+        } else {
+            buf += noSize_;
+        }
+    } else {
+        buf += line;
+    }
+    lineCount_ += newlines;
+
+    if (!terminal_) {
+        out_.commit();
+        return;
+    }
+    // Redraws and a visible tree about 30 times a second, not one write() per line
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastFlush_ >= std::chrono::milliseconds(33)) {
+        apply(false);
+        out_.flush();
+        lastFlush_ = now;
+    }
+}
+
+// Hands the open folders at 'depth' or deeper to the pool
+void ProgressiveRenderer::close(std::size_t depth) {
+    while (!open_.empty() && folders_[open_.back()].depth >= depth) {
+        const std::size_t id = open_.back();
+        open_.pop_back();
+        Folder& folder = folders_[id];
+        std::sort(folder.listed.begin(), folder.listed.end());
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++outstanding_;
+        }
+        pool_.submit([this, id, dir = folder.dir, listed = std::move(folder.listed)] {
+            // The listed subfolders add their own size
+            std::uintmax_t size = scanner_.size(root_, dir, listed);
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_.emplace_back(id, size);
+            --outstanding_;
+            ready_.notify_one();
+        });
+    }
+}
+
+// Adds 'size' to a folder; once nothing is missing its size is final and
+// goes on to its parent
+void ProgressiveRenderer::add(std::size_t id, std::uintmax_t size) {
+    while (id != kNoParent) {
+        Folder& folder = folders_[id];
+        folder.size += size;
+        if (--folder.pending > 0) return;
+        if (terminal_) redraw(folder);
+        size = folder.size;
+        id = folder.parent;
+    }
+}
+
+// Redraws the folders whose size is final; with 'wait' until none is left
+void ProgressiveRenderer::apply(bool wait) {
+    std::vector<std::pair<std::size_t, std::uintmax_t>> done;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (wait) ready_.wait(lock, [this] { return !done_.empty() || outstanding_ == 0; });
+            done.swap(done_);
+            if (done.empty() && (!wait || outstanding_ == 0)) return;
+        }
+        for (auto& [id, size] : done) add(id, size);
+        done.clear();
+        if (!wait) return;
+        out_.flush();
+    }
+}
+
+// Rewrites the line of 'folder' in place if it is still on screen
+void ProgressiveRenderer::redraw(Folder& folder) {
+    const std::size_t up = lineCount_ - folder.line;
+    if (up >= rows_) return;
+
+    std::string& buf = out_.buffer();
+    appendCursorMove(buf, up, 'A');
+    buf += '\r';
+    buf += folder.head;
+    appendSizeSuffix(buf, folder.size, color_);
+    buf += "\033[K";
+    appendCursorMove(buf, up, 'B');
+    buf += '\r';
+    folder.shown = true;
+}
+
+void ProgressiveRenderer::finish() {
+    if (finished_) return;
+    finished_ = true;
+    close(0);
+    apply(true);
+
+    std::string& buf = out_.buffer();
+    bool header = false;
+    for (const Folder& folder : folders_) {
+        if (folder.shown) continue;
+        if (!header) {
+            buf += "\n ";
+            buf += ansi(color_, kBold);
+            buf += "Folder sizes:";
+            buf += ansi(color_, kReset);
+            buf += '\n';
+            header = true;
+        }
+        buf += ' ';
+        buf += folder.path;
+        buf += '/';
+        appendSizeSuffix(buf, folder.size, color_);
+        buf += '\n';
+        out_.commit();
+    }
+    if (terminal_) buf += "\033[?7h";
+    out_.flush();
+}
+
+} // namespace appletree
@@ -0,0 +1,455 @@
+#include "appletree/regex.h"
+
+#include <bitset>
+#include <cctype>
+
+namespace appletree {
+
+namespace {
+
+// Upper bound for one pattern's NFA (protects against 'a{1000}{1000}'-style blowups)
+constexpr int kMaxNfaStates = 200000;
+constexpr int kMaxRepeat = 1000;
+
+struct Frag {
+    int start;
+    int end;   // dangling state, connected by epsilon edges
+};
+
+class RegexCompiler {
+public:
+    RegexCompiler(Nfa& nfa, std::string_view p) : nfa_(nfa), p_(p) {}
+
+    bool compile(int id, std::string& error) {
+        Frag f = alternation(true);
+        if (error_.empty() && pos_ < p_.size()) fail("unmatched ')'");
+        if (error_.empty() && nfa_.size() > kMaxNfaStates) fail("pattern too large");
+        if (!error_.empty()) {
+            error = error_;
+            return false;
+        }
+        nfa_.addStart(f.start);
+        nfa_[f.end].accept = id;
+        return true;
+    }
+
+private:
+    Nfa& nfa_;
+    std::string_view p_;
+    std::size_t pos_ = 0;
+    std::string error_;
+
+    bool ok() const { return error_.empty(); }
+    bool more() const { return pos_ < p_.size() && ok(); }
+    char peek() const { return p_[pos_]; }
+
+    Frag fail(const std::string& msg) {
+        if (error_.empty()) error_ = msg;
+        return empty();
+    }
+
+    // ---- Fragment construction ----
+
+    Frag empty() {
+        int s = nfa_.add();
+        int e = nfa_.add();
+        nfa_[s].eps.push_back(e);
+        return {s, e};
+    }
+
+    Frag bytes(const std::bitset<256>& set) {
+        int s = nfa_.add();
+        int e = nfa_.add();
+        nfa_[s].bytes = set;
+        nfa_[s].next = e;
+        return {s, e};
+    }
+
+    // '.*' used for the unanchored sides
+    Frag anything() {
+        int s = nfa_.add();
+        int e = nfa_.add();
+        nfa_[s].bytes.set();
+        nfa_[s].next = s;
+        nfa_[s].eps.push_back(e);
+        return {s, e};
+    }
+
+    Frag concat(Frag a, Frag b) {
+        nfa_[a.end].eps.push_back(b.start);
+        return {a.start, b.end};
+    }
+
+    Frag alternate(Frag a, Frag b) {
+        int s = nfa_.add();
+        int e = nfa_.add();
+        nfa_[s].eps = {a.start, b.start};
+        nfa_[a.end].eps.push_back(e);
+        nfa_[b.end].eps.push_back(e);
+        return {s, e};
+    }
+
+    Frag star(Frag a) {
+        int s = nfa_.add();
+        int e = nfa_.add();
+        nfa_[s].eps = {a.start, e};
+        nfa_[a.end].eps.push_back(a.start);
+        nfa_[a.end].eps.push_back(e);
+        return {s, e};
+    }
+
+    Frag plus(Frag a) {
+        int e = nfa_.add();
+        nfa_[a.end].eps.push_back(a.start);
+        nfa_[a.end].eps.push_back(e);
+        return {a.start, e};
+    }
+
+    Frag optional(Frag a) {
+        int s = nfa_.add();
+        int e = nfa_.add();
+        nfa_[s].eps = {a.start, e};
+        nfa_[a.end].eps.push_back(e);
+        return {s, e};
+    }
+
+    // ---- Parser ----
+
+    Frag alternation(bool topLevel) {
+        Frag f = branch(topLevel);
+        while (more() && peek() == '|') {
+            ++pos_;
+            f = alternate(f, branch(topLevel));
+        }
+        return f;
+    }
+
+    Frag branch(bool topLevel) {
+        bool anchoredStart = false;
+        bool anchoredEnd = false;
+        if (topLevel && more() && peek() == '^') {
+            anchoredStart = true;
+            ++pos_;
+        }
+
+        Frag f = empty();
+        while (more() && peek() != '|' && peek() != ')') {
+            if (peek() == '$') {
+                if (!topLevel || (pos_ + 1 < p_.size() && p_[pos_ + 1] != '|')) {
+                    return fail("'$' is only supported at the end of the pattern");
+                }
+                anchoredEnd = true;
+                ++pos_;
+                break;
+            }
+            if (peek() == '^') return fail("'^' is only supported at the start of the pattern");
+            f = concat(f, repeat());
+        }
+
+        if (topLevel && !anchoredStart) f = concat(anything(), f);
+        if (topLevel && !anchoredEnd) f = concat(f, anything());
+        return f;
+    }
+
+    bool parseCount(int& value) {
+        std::size_t start = pos_;
+        value = 0;
+        while (pos_ < p_.size() && p_[pos_] >= '0' && p_[pos_] <= '9') {
+            value = value * 10 + (p_[pos_] - '0');
+            if (value > kMaxRepeat) {
+                fail("repeat count too large");
+                return false;
+            }
+            ++pos_;
+        }
+        return pos_ > start;
+    }
+
+    // Parses "{n}", "{n,}" or "{n,m}" at pos_; false (pos_ unchanged) if it is a literal '{'
+    bool parseBraces(int& lo, int& hi) {
+        std::size_t save = pos_;
+        ++pos_;
+        if (!parseCount(lo)) {
+            pos_ = save;
+            return false;
+        }
+        hi = lo;
+        if (pos_ < p_.size() && p_[pos_] == ',') {
+            ++pos_;
+            if (!parseCount(hi)) hi = -1;
+        }
+        if (pos_ >= p_.size() || p_[pos_] != '}' || (hi >= 0 && hi < lo)) {
+            pos_ = save;
+            return false;
+        }
+        ++pos_;
+        return true;
+    }
+
+    Frag repeat() {
+        const std::size_t atomStart = pos_;
+        Frag f = atom();
+        if (!more()) return f;
+
+        int lo = 0;
+        int hi = 0;
+        char q = peek();
+        if (q == '*') {
+            ++pos_;
+            f = star(f);
+        } else if (q == '+') {
+            ++pos_;
+            f = plus(f);
+        } else if (q == '?') {
+            ++pos_;
+            f = optional(f);
+        } else if (q == '{' && parseBraces(lo, hi)) {
+            f = counted(f, atomStart, lo, hi);
+        } else {
+            return f;
+        }
+
+        if (more() && peek() == '?') ++pos_;   // lazy: same language
+        if (more() && (peek() == '*' || peek() == '+' || peek() == '?'
+                       || (peek() == '{' && parseBraces(lo, hi)))) {
+            return fail("multiple repeat operators");
+        }
+        return f;
+    }
+
+    // Re-parses the atom text for every additional copy
+    Frag atomCopy(std::size_t atomStart) {
+        std::size_t save = pos_;
+        pos_ = atomStart;
+        Frag f = atom();
+        pos_ = save;
+        return f;
+    }
+
+    Frag counted(Frag first, std::size_t atomStart, int lo, int hi) {
+        Frag f = empty();
+        bool haveFirst = true;
+        auto next = [&]() {
+            if (haveFirst) {
+                haveFirst = false;
+                return first;
+            }
+            return atomCopy(atomStart);
+        };
+        for (int i = 0; i < lo && ok(); ++i) {
+            f = concat(f, next());
+            if (nfa_.size() > kMaxNfaStates) return fail("pattern too large");
+        }
+        if (hi < 0) return concat(f, star(next()));
+        for (int i = lo; i < hi && ok(); ++i) {
+            f = concat(f, optional(next()));
+            if (nfa_.size() > kMaxNfaStates) return fail("pattern too large");
+        }
+        return f;
+    }
+
+    static std::bitset<256> range(int lo, int hi) {
+        std::bitset<256> set;
+        for (int c = lo; c <= hi; ++c) set.set(c);
+        return set;
+    }
+
+    // Class escapes (\d, \w, \s and their negations); false for other escapes
+    static bool classEscape(char c, std::bitset<256>& set) {
+        switch (c) {
+            case 'd': case 'D':
+                set = range('0', '9');
+                break;
+            case 'w': case 'W':
+                set = range('a', 'z') | range('A', 'Z') | range('0', '9');
+                set.set('_');
+                break;
+            case 's': case 'S':
+                set.reset();
+                for (char w : {' ', '\t', '\n', '\r', '\f', '\v'}) set.set(static_cast<unsigned char>(w));
+                break;
+            default:
+                return false;
+        }
+        if (c == 'D' || c == 'W' || c == 'S') set = ~set;
+        return true;
+    }
+
+    // Escapes that stand for one byte: \n \t \r \f \v and any escaped
+    // character that is not a letter or digit. Other letters (\b, \A, \x,
+    // ...) mean something else in other dialects, so they are an error
+    // rather than a silent literal.
+    bool literalEscape(char c, unsigned char& out) {
+        switch (c) {
+            case 'n': out = '\n'; return true;
+            case 't': out = '\t'; return true;
+            case 'r': out = '\r'; return true;
+            case 'f': out = '\f'; return true;
+            case 'v': out = '\v'; return true;
+        }
+        if (std::isalnum(static_cast<unsigned char>(c))) {
+            if (c >= '1' && c <= '9') fail("backreferences are not supported");
+            else fail(std::string("unsupported escape '\\") + c + "'");
+            return false;
+        }
+        out = static_cast<unsigned char>(c);
+        return true;
+    }
+
+    // POSIX bracket expressions inside a class, at '[' followed by ':', '='
+    // or '.': [:alpha:] and the other ASCII classes are added to 'set';
+    // [=e=] and [.ch.] are an error. False (nothing consumed) if there is
+    // no closing ":]", "=]" or ".]", leaving a literal '['.
+    bool posixClass(std::bitset<256>& set) {
+        const char kind = p_[pos_ + 1];
+        const std::size_t close = p_.find(std::string{kind, ']'}, pos_ + 2);
+        if (close == std::string_view::npos) return false;
+        const std::string_view name = p_.substr(pos_ + 2, close - pos_ - 2);
+        pos_ = close + 2;
+        if (kind != ':') {
+            fail("equivalence classes and collating elements are not supported");
+            return true;
+        }
+
+        static const struct {
+            const char* name;
+            int (*test)(int);
+        } kClasses[] = {
+            {"alnum", [](int c) { return std::isalnum(c); }}, {"alpha", [](int c) { return std::isalpha(c); }},
+            {"blank", [](int c) { return std::isblank(c); }}, {"cntrl", [](int c) { return std::iscntrl(c); }},
+            {"digit", [](int c) { return std::isdigit(c); }}, {"graph", [](int c) { return std::isgraph(c); }},
+            {"lower", [](int c) { return std::islower(c); }}, {"print", [](int c) { return std::isprint(c); }},
+            {"punct", [](int c) { return std::ispunct(c); }}, {"space", [](int c) { return std::isspace(c); }},
+            {"upper", [](int c) { return std::isupper(c); }}, {"xdigit", [](int c) { return std::isxdigit(c); }},
+        };
+        for (const auto& cls : kClasses) {
+            if (name != cls.name) continue;
+            for (int c = 0; c < 0x80; ++c) {
+                if (cls.test(c)) set.set(c);
+            }
+            return true;
+        }
+        fail("unknown character class '[:" + std::string(name) + ":]'");
+        return true;
+    }
+
+    Frag charClass() {
+        ++pos_;   // '['
+        bool negate = pos_ < p_.size() && p_[pos_] == '^';
+        if (negate) ++pos_;
+
+        std::bitset<256> set;
+        bool first = true;
+        while (ok() && pos_ < p_.size() && (first || p_[pos_] != ']')) {
+            first = false;
+            unsigned char lo;
+            if (p_[pos_] == '[' && pos_ + 1 < p_.size() && (p_[pos_ + 1] == ':' || p_[pos_ + 1] == '=' ||
+                                                           p_[pos_ + 1] == '.') && posixClass(set)) {
+                continue;
+            }
+            if (p_[pos_] == '\\' && pos_ + 1 < p_.size()) {
+                std::bitset<256> esc;
+                if (classEscape(p_[pos_ + 1], esc)) {
+                    set |= esc;
+                    pos_ += 2;
+                    continue;
+                }
+                if (!literalEscape(p_[pos_ + 1], lo)) return empty();
+                pos_ += 2;
+            } else {
+                lo = static_cast<unsigned char>(p_[pos_++]);
+            }
+            unsigned char hi = lo;
+            if (pos_ + 1 < p_.size() && p_[pos_] == '-' && p_[pos_ + 1] != ']') {
+                ++pos_;
+                if (p_[pos_] == '\\' && pos_ + 1 < p_.size()) {
+                    if (!literalEscape(p_[pos_ + 1], hi)) return empty();
+                    pos_ += 2;
+                } else {
+                    hi = static_cast<unsigned char>(p_[pos_++]);
+                }
+                if (hi < lo) return fail("invalid range in character class");
+            }
+            set |= range(lo, hi);
+        }
+        if (!ok()) return empty();
+        if (pos_ >= p_.size()) return fail("missing ']'");
+        ++pos_;   // ']'
+        return bytes(negate ? ~set : set);
+    }
+
+    Frag atom() {
+        char c = peek();
+        switch (c) {
+            case '(': {
+                ++pos_;
+                if (p_.compare(pos_, 2, "?:") == 0) pos_ += 2;
+                else if (pos_ < p_.size() && p_[pos_] == '?') return fail("unsupported group syntax");
+                Frag f = alternation(false);
+                if (!ok()) return f;
+                if (pos_ >= p_.size() || p_[pos_] != ')') return fail("missing ')'");
+                ++pos_;
+                return f;
+            }
+            case '[':
+                return charClass();
+            case '.': {
+                ++pos_;
+                std::bitset<256> all;
+                all.set();
+                return bytes(all);
+            }
+            case '\\': {
+                if (pos_ + 1 >= p_.size()) return fail("trailing backslash");
+                char e = p_[pos_ + 1];
+                pos_ += 2;
+                std::bitset<256> set;
+                if (!classEscape(e, set)) {
+                    unsigned char literal;
+                    if (!literalEscape(e, literal)) return empty();
+                    set.set(literal);
+                }
+                return bytes(set);
+            }
+            case '*': case '+': case '?':
+                return fail("nothing to repeat");
+            default: {
+                ++pos_;
+                std::bitset<256> set;
+                set.set(static_cast<unsigned char>(c));
+                return bytes(set);
+            }
+        }
+    }
+};
+
+} // namespace
+
+bool addRegex(Nfa& nfa, std::string_view pattern, int id, std::string& error) {
+    // Compile into a scratch NFA first so a failed pattern leaves 'nfa' untouched
+    Nfa scratch;
+    if (!RegexCompiler(scratch, pattern).compile(0, error)) return false;
+
+    const int offset = nfa.size();
+    for (int i = 0; i < scratch.size(); ++i) {
+        NfaState st = scratch[i];
+        if (st.next >= 0) st.next += offset;
+        for (int& e : st.eps) e += offset;
+        if (st.accept >= 0) st.accept = id;
+        nfa[nfa.add()] = std::move(st);
+    }
+    for (int s : scratch.starts()) nfa.addStart(s + offset);
+    return true;
+}
+
+bool RegexFilter::add(const std::string& pattern, std::string& error) {
+    if (!addRegex(nfa_, pattern, count_, error)) return false;
+    ++count_;
+    return true;
+}
+
+void RegexFilter::compile() {
+    if (count_ > 0) dfa_ = Dfa(nfa_);
+}
+
+} // namespace appletree
@@ -0,0 +1,325 @@
+#include "appletree/render.h"
+
+#include "appletree/binfmt.h"
+#include "appletree/format.h"
+#include "appletree/json.h"
+
+#include <ctime>
+#include <vector>
+
+namespace appletree {
+
+const char* branch(Theme theme, bool isLast) {
+    if (theme == Theme::round) {
+        return isLast ? "╰── " : "├── ";
+    } else {
+        return isLast ? "└── " : "├── ";
+    }
+}
+
+const char* vertical(Theme theme, bool isLast) {
+    if (theme == Theme::round) {
+        return isLast ? "    " : "│   ";
+    } else {
+        return isLast ? "    " : "│   ";
+    }
+}
+
+namespace {
+
+// Appends 'code' in the colored variant of a function; the plain variant
+// compiles to nothing
+template <bool Color>
+void paint(std::string& out, const char* code) {
+    if constexpr (Color) out += code;
+}
+
+template <bool Color>
+void hashSuffix(std::string& out, std::uint64_t hash) {
+    paint<Color>(out, kFgGray);
+    out += " [";
+    appendHex64(out, hash);
+    out += ']';
+    paint<Color>(out, kReset);
+}
+
+template <bool Color>
+void sizeSuffix(std::string& out, const std::optional<std::uintmax_t>& size) {
+    paint<Color>(out, kFgGray);
+    if (size) {
+        out += " (";
+        appendSize(out, *size);
+        out += ')';
+    }
+    paint<Color>(out, kReset);
+}
+
+template <bool Color>
+void detailsSuffix(std::string& out, const std::optional<std::uintmax_t>& size, const LineDetails& details) {
+    paint<Color>(out, kFgGray);
+    const char* separator = " (";
+    if (size) {
+        out += separator;
+        appendSize(out, *size);
+        separator = ", ";
+    }
+    if (details.counts) {
+        out += separator;
+        appendGrouped(out, details.files);
+        out += details.files == 1 ? " file, " : " files, ";
+        appendGrouped(out, details.folders);
+        out += details.folders == 1 ? " folder" : " folders";
+        separator = ", ";
+    }
+    if (details.age) {
+        out += separator;
+        appendAge(out, *details.age);
+        out += " ago";
+        separator = ", ";
+    }
+    if (separator[0] == ',') out += ')';
+    paint<Color>(out, kReset);
+}
+
+template <bool Color>
+void treeName(std::string& out, const std::string& prefix, bool isLast, std::string_view name, bool isDir,
+              Theme theme, const char* nameColor) {
+    out += ' ';
+    out += prefix;
+    out += branch(theme, isLast);
+    if constexpr (Color) {
+        out += kReset;
+        if (nameColor) out += nameColor;
+        if (isDir) {
+            out += kBold;
+            out += name;
+            out += '/';
+            out += kReset;
+        } else {
+            out += name;
+            if (nameColor) out += kReset;
+        }
+    } else {
+        out += name;
+        if (isDir) out += '/';
+    }
+}
+
+} // namespace
+
+void appendHashSuffix(std::string& out, std::uint64_t hash, bool color) {
+    if (color) hashSuffix<true>(out, hash);
+    else hashSuffix<false>(out, hash);
+}
+
+void appendSizeSuffix(std::string& out, std::optional<std::uintmax_t> size, bool color) {
+    if (color) sizeSuffix<true>(out, size);
+    else sizeSuffix<false>(out, size);
+}
+
+void appendDetailsSuffix(std::string& out, std::optional<std::uintmax_t> size, const LineDetails& details,
+                         bool color) {
+    if (color) detailsSuffix<true>(out, size, details);
+    else detailsSuffix<false>(out, size, details);
+}
+
+const char* ageColor(std::int64_t seconds) {
+    constexpr std::int64_t day = 86400;
+    if (seconds < day) return kFgRed;
+    if (seconds < 7 * day) return kFgYellow;
+    if (seconds < 90 * day) return kFgGreen;
+    if (seconds < 365 * day) return kFgCyan;
+    return kFgBlue;
+}
+
+void appendTreeName(std::string& out, const std::string& prefix, bool isLast,
+                    std::string_view name, bool isDir, Theme theme, const char* nameColor, bool color) {
+    if (color) treeName<true>(out, prefix, isLast, name, isDir, theme, nameColor);
+    else treeName<false>(out, prefix, isLast, name, isDir, theme, nameColor);
+}
+
+void appendTreeLine(std::string& out, const std::string& prefix, bool isLast,
+                    std::string_view name, bool isDir, std::optional<std::uintmax_t> size,
+                    Theme theme, bool color) {
+    appendTreeName(out, prefix, isLast, name, isDir, theme, nullptr, color);
+    appendSizeSuffix(out, size, color);
+    out += '\n';
+}
+
+namespace {
+
+// Walks 'node' depth-first, keeping the relative path in one buffer
+void replay(Renderer& renderer, const Node& node, std::string& path, std::size_t depth, bool isLast) {
+    EntryView view;
+    view.name = node.name;
+    view.path = path;
+    view.type = node.type;
+    view.isDir = node.isDir;
+    view.size = node.size;
+    view.mtime = node.mtime;
+    view.dev = node.dev;
+    view.ino = node.ino;
+    view.mtimeNs = node.mtimeNs;
+    view.ctimeNs = node.ctimeNs;
+    view.hash = node.hash;
+    view.files = node.files;
+    view.folders = node.folders;
+    view.newest = node.newest;
+    view.unscanned = node.unscanned;
+    renderer.entry(view, depth, isLast);
+
+    std::size_t length = path.size();
+    for (std::size_t i = 0; i < node.children.size(); ++i) {
+        const Node& child = node.children[i];
+        if (depth == 0) {
+            path.assign(child.name);
+        } else {
+            path.resize(length);
+            path += '/';
+            path += child.name;
+        }
+        replay(renderer, child, path, depth + 1, i == node.children.size() - 1);
+    }
+}
+
+// The drawn tree. The prefix of every depth is kept in one string; 'marks_'
+// holds where the prefix for the children of each open directory ends.
+// Instantiated with and without ANSI styles, so plain output ('--color
+// never', or auto when not writing to a terminal) skips them entirely.
+template <bool Color>
+class TextRenderer : public Renderer {
+public:
+    TextRenderer(OutputWriter& out, const RenderOptions& options)
+        : out_(out), options_(options), now_(static_cast<std::int64_t>(std::time(nullptr))) {}
+
+    void entry(const EntryView& entry, std::size_t depth, bool isLast) override {
+        std::optional<std::uintmax_t> size = options_.sizes ? entry.size : std::nullopt;
+        std::string& buf = out_.buffer();
+
+        LineDetails details;
+        if (!entry.unscanned) {
+            details.counts = options_.counts && entry.isDir;
+            details.files = entry.files;
+            details.folders = entry.folders;
+            // Folder ages come from the newest mtime summed up with the sizes
+            if (options_.age) details.age = now_ - (entry.isDir ? entry.newest : entry.mtime);
+        }
+        const char* nameColor = nullptr;
+        if constexpr (Color) {
+            if (options_.ageColor && details.age) nameColor = ageColor(*details.age);
+        }
+
+        if (depth == 0) {
+            // Display root directory
+            buf += "\n ";
+            paint<Color>(buf, kBold);
+            if (nameColor) buf += nameColor;
+            buf += entry.name;
+            buf += '/';
+            paint<Color>(buf, kReset);
+            prefix_.clear();
+            marks_.assign(1, 0);
+        } else {
+            prefix_.resize(marks_[depth - 1]);
+            treeName<Color>(buf, prefix_, isLast, entry.name, entry.isDir, options_.theme, nameColor);
+            if (entry.isDir) {
+                prefix_ += vertical(options_.theme, isLast);
+                marks_.resize(depth + 1);
+                marks_[depth] = prefix_.size();
+            }
+        }
+
+        if (details.counts || details.age) {
+            detailsSuffix<Color>(buf, size, details);
+        } else {
+            sizeSuffix<Color>(buf, size);
+        }
+        if (entry.hash) hashSuffix<Color>(buf, *entry.hash);
+        if (entry.unscanned) {
+            paint<Color>(buf, kFgYellow);
+            buf += " (not scanned)";
+            paint<Color>(buf, kReset);
+        }
+        buf += '\n';
+        out_.commit();
+    }
+
+private:
+    OutputWriter& out_;
+    RenderOptions options_;
+    std::int64_t now_;            // ages are relative to the start of the output
+    std::string prefix_;
+    std::vector<std::size_t> marks_;
+};
+
+// One NDJSON object per line
+class NdjsonRenderer : public Renderer {
+public:
+    NdjsonRenderer(OutputWriter& out, const RenderOptions& options) : out_(out), options_(options) {}
+
+    void entry(const EntryView& entry, std::size_t depth, bool) override {
+        extra_.clear();
+        if (options_.counts && entry.isDir && !entry.unscanned) appendJsonCounts(extra_, entry.files, entry.folders);
+        if (options_.age && entry.isDir && !entry.unscanned) appendJsonNewest(extra_, entry.newest);
+        appendNdjsonRecord(out_.buffer(), entry.path, entry.type, depth, entry.size, entry.mtime, entry.hash,
+                           entry.unscanned, extra_);
+        out_.commit();
+    }
+
+private:
+    OutputWriter& out_;
+    RenderOptions options_;
+    std::string extra_;
+};
+
+// Binary record stream, header written in front of the root record
+class BinRenderer : public Renderer {
+public:
+    explicit BinRenderer(OutputWriter& out) : out_(out) {}
+
+    void entry(const EntryView& entry, std::size_t depth, bool) override {
+        if (depth == 0) appendBinHeader(out_.buffer());
+        appendBinRecord(out_.buffer(), static_cast<std::uint32_t>(depth), static_cast<std::uint8_t>(entry.type),
+                        entry.size.has_value(), entry.size.value_or(0), entry.mtime, entry.name,
+                        entry.hash.has_value(), entry.dev, entry.ino, entry.mtimeNs, entry.ctimeNs,
+                        entry.hash.value_or(0));
+        out_.commit();
+    }
+
+private:
+    OutputWriter& out_;
+};
+
+// Nested document like 'tree -J'
+class JsonRenderer : public Renderer {
+public:
+    JsonRenderer(OutputWriter& out, const RenderOptions& options) : out_(out), options_(options) {}
+
+    void entry(const EntryView&, std::size_t, bool) override {}
+    bool needsTree() const override { return true; }
+    void render(const Tree& tree) override { writeJsonTree(out_, tree.root, options_.counts, options_.age); }
+
+private:
+    OutputWriter& out_;
+    RenderOptions options_;
+};
+
+} // namespace
+
+void Renderer::render(const Tree& tree) {
+    std::string path = ".";
+    replay(*this, tree.root, path, 0, true);
+}
+
+std::unique_ptr<Renderer> makeRenderer(OutputWriter& out, const RenderOptions& options) {
+    switch (options.format) {
+        case Format::ndjson: return std::make_unique<NdjsonRenderer>(out, options);
+        case Format::json:   return std::make_unique<JsonRenderer>(out, options);
+        case Format::bin:    return std::make_unique<BinRenderer>(out);
+        case Format::tree:   break;
+    }
+    if (options.color) return std::make_unique<TextRenderer<true>>(out, options);
+    return std::make_unique<TextRenderer<false>>(out, options);
+}
+
+} // namespace appletree
@@ -0,0 +1,564 @@
+#include "appletree/scan.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include <sys/stat.h>
+
+#include "appletree/budget.h"
+#include "appletree/ignore.h"
+#include "appletree/pool.h"
+#include "appletree/render.h"
+
+namespace appletree {
+
+namespace fs = std::filesystem;
+
+std::uintmax_t dirSizeRecursive(const fs::path& dir) {
+    std::uintmax_t total = 0;
+    std::error_code ec;
+    for (auto& entry : fs::recursive_directory_iterator(dir, fs::directory_options::skip_permission_denied, ec)) {
+        if (fs::is_regular_file(entry.path(), ec)) {
+            auto s = fs::file_size(entry.path(), ec);
+            if (!ec) total += s;
+        }
+    }
+
+    return total;
+}
+
+void ScanOptions::compile() {
+    exclude.compile();
+    only.compile();
+    excludeRegex.compile();
+    onlyRegex.compile();
+}
+
+namespace {
+
+// How much of a folder was read
+enum class Listing {complete, cut, skipped};
+
+// Traversal state of one scan
+struct ScanContext {
+    const ScanOptions& options;
+    fs::path root;
+    IgnoreStack ignoreStack;
+    std::unique_ptr<DirReader> reader;    // only with a deadline
+
+    // 'loadIgnore' false: the caller fills in ignoreStack
+    ScanContext(const ScanOptions& options, const fs::path& root, bool loadIgnore = true)
+        : options(options), root(root) {
+        if (options.gitignore && loadIgnore) ignoreStack.init(root);
+        if (options.budget && options.budget->hasDeadline()) {
+            reader = std::make_unique<DirReader>(options.budget->deadline());
+        }
+    }
+
+    // Reads 'dir' as far as the budget allows
+    Listing read(const fs::path& dir, std::vector<DirEntry>& out) {
+        ScanBudget* budget = options.budget;
+        if (!budget) {
+            readDirectory(dir, out, std::numeric_limits<std::size_t>::max());
+            return Listing::complete;
+        }
+        if (budget->spent()) return Listing::skipped;
+
+        bool complete;
+        if (reader) {
+            DirReader::Result result = reader->read(dir, out, budget->remaining());
+            if (result == DirReader::Result::timedOut) {
+                budget->expire();
+                return Listing::skipped;
+            }
+            complete = result == DirReader::Result::complete;
+        } else {
+            complete = readDirectory(dir, out, budget->remaining());
+        }
+        budget->charge(out.size());
+        return complete ? Listing::complete : Listing::cut;
+    }
+
+    IgnoreStack* ignore(std::size_t depth) {
+        return options.gitignore && depth > 0 ? &ignoreStack : nullptr;
+    }
+
+    bool belowDepthLimit(std::size_t depth) const {
+        return options.maxDepth.has_value() && depth >= options.maxDepth.value();
+    }
+};
+
+// Helper Functions
+std::pair<bool, std::uintmax_t> fileSizeSafe(const fs::path& p) {
+    std::error_code ec;
+    if (!fs::is_regular_file(p, ec) || ec) return {false, 0};
+    auto s = fs::file_size(p, ec);
+    if (ec) return {false, 0};
+    return {true, s};
+}
+
+// Fills 'node' (type, mtime, isDir, file size) from lstat; false if the entry
+// vanished. Links are followed for isDir and, with sizes, for their target's size.
+bool statNode(const ScanContext& ctx, const fs::path& p, Node& node) {
+    struct stat st;
+    if (::lstat(p.c_str(), &st) != 0) return false;
+    node.type = entryTypeFromMode(st.st_mode);
+    node.mtime = static_cast<std::int64_t>(st.st_mtime);
+    node.dev = static_cast<std::uint64_t>(st.st_dev);
+    node.ino = static_cast<std::uint64_t>(st.st_ino);
+    node.mtimeNs = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    node.ctimeNs = static_cast<std::int64_t>(st.st_ctim.tv_sec) * 1000000000 + st.st_ctim.tv_nsec;
+    node.isDir = node.type == EntryType::directory;
+
+    if (node.type == EntryType::file) {
+        node.size = static_cast<std::uintmax_t>(st.st_size);
+    } else if (node.type == EntryType::symlink) {
+        std::error_code ec;
+        node.isDir = fs::is_directory(p, ec);
+        if (ctx.options.sizes && !node.isDir) {
+            auto [hasSize, bytes] = fileSizeSafe(p);
+            if (hasSize) node.size = bytes;
+        }
+    }
+    return true;
+}
+
+// Size, file and folder count of everything below a folder
+struct Totals {
+    std::uintmax_t size = 0;
+    std::uint64_t files = 0;
+    std::uint64_t folders = 0;
+    std::int64_t newest = std::numeric_limits<std::int64_t>::min();
+};
+
+// Stores 'totals' in 'node'; its own mtime joins the newest one
+void setTotals(Node& node, Totals& totals) {
+    totals.newest = std::max(totals.newest, node.mtime);
+    node.size = totals.size;
+    node.files = totals.files;
+    node.folders = totals.folders;
+    node.newest = totals.newest;
+}
+
+// Counts 'p' if it is a regular file (links followed); one stat()
+void addFile(const fs::path& p, Totals& totals) {
+    struct stat st;
+    if (::stat(p.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+        totals.size += static_cast<std::uintmax_t>(st.st_size);
+        ++totals.files;
+        totals.newest = std::max(totals.newest, static_cast<std::int64_t>(st.st_mtime));
+    }
+}
+
+// Whether .gitignore ignores 'entry' of the top folder of the ignore stack.
+// Ignored entries are left out like absent ones: never listed, counted or read.
+bool ignored(const ScanContext& ctx, const DirEntry& entry) {
+    return ctx.options.gitignore && ctx.ignoreStack.isIgnored(entry.path.filename().string(), entry.isDir);
+}
+
+bool foldTree(ScanContext& ctx, const fs::path& dir, Totals& totals, Node* folders = nullptr);
+
+// Folds 'entries' and everything below them into 'totals' without keeping
+// any of it. Unfiltered like dirSizeRecursive(), apart from what .gitignore
+// ignores; links to folders are not followed. With 'folders', each folder
+// folded is added to its children with its size and own subfolders. False
+// if the budget ran out first.
+bool foldEntries(ScanContext& ctx, const std::vector<DirEntry>& entries, Totals& totals, Node* folders = nullptr) {
+    for (const auto& entry : entries) {
+        if (ignored(ctx, entry)) continue;
+        if (entry.isDir && !entry.isLink) {
+            ++totals.folders;
+            IgnoreScope ignoreScope(ctx.options.gitignore ? &ctx.ignoreStack : nullptr, entry.path);
+            Node* folder = nullptr;
+            if (folders) {
+                folder = &folders->children.emplace_back();
+                folder->name = entry.path.filename().string();
+                folder->type = EntryType::directory;
+                folder->isDir = true;
+            }
+            const std::uintmax_t before = totals.size;
+            const bool complete = foldTree(ctx, entry.path, totals, folder);
+            if (folder) folder->size = totals.size - before;
+            if (!complete) return false;
+        } else {
+            addFile(entry.path, totals);
+        }
+    }
+    return true;
+}
+
+// foldEntries() for everything below 'dir' (the top folder of the ignore stack)
+bool foldTree(ScanContext& ctx, const fs::path& dir, Totals& totals, Node* folders) {
+    std::vector<DirEntry> entries;
+    if (ctx.read(dir, entries) != Listing::complete) return false;
+    return foldEntries(ctx, entries, totals, folders);
+}
+
+// Whether 'entry' passes the -e/-o filters (OnlyMatch::below:
+// only in case something inside it is kept)
+OnlyMatch keepEntry(ScanContext& ctx, const DirEntry& entry) {
+    const ScanOptions& options = ctx.options;
+    const std::string filename = entry.path.filename().string();
+
+    // Hidden via "-e ."
+    if (options.exclude.isHidden(filename)) return OnlyMatch::none;
+
+    std::error_code ec2;
+    const bool isDir = entry.isDir;
+
+    // Relative Path regarding root (for -e/-o)
+    std::string rel;
+    {
+        auto canon = fs::weakly_canonical(entry.path, ec2);
+        if (ec2) return OnlyMatch::none; // skip
+        rel = canon.lexically_relative(ctx.root).generic_string();
+    }
+
+    // Exclude (-e, --exclude-re)
+    if (!options.exclude.empty() && options.exclude.matches(filename, rel)) return OnlyMatch::none;
+    if (!options.excludeRegex.empty() && options.excludeRegex.matches(rel)) return OnlyMatch::none;
+
+    // Only (-o, --only-re)
+    OnlyMatch only = options.only.empty() ? OnlyMatch::match : options.only.match(rel, isDir);
+    if (only == OnlyMatch::none || options.onlyRegex.empty()) return only;
+    const OnlyMatch onlyRe = options.onlyRegex.keeps(rel, isDir);
+    if (onlyRe == OnlyMatch::none) return onlyRe;
+    return only == OnlyMatch::below || onlyRe == OnlyMatch::below ? OnlyMatch::below : OnlyMatch::match;
+}
+
+// An entry listEntries() kept
+struct KeptEntry {
+    fs::path path;
+    bool onlyBelow = false;       // see Node::onlyBelow
+};
+
+// Lists the entries of 'current' that pass the -e/-o filters, sorted by name
+// (or in the '--sort' order). The others go to 'dropped' if given, apart
+// from the ones .gitignore ignores.
+Listing listEntries(ScanContext& ctx, const fs::path& current, std::vector<KeptEntry>& entries,
+                    std::vector<DirEntry>* dropped = nullptr) {
+    // Collect all files & folders within the root directory
+    std::vector<DirEntry> dirEntries;
+    Listing listing = ctx.read(current, dirEntries);
+    for (auto& entry : dirEntries) {
+        if (ignored(ctx, entry)) continue;
+        OnlyMatch keep = keepEntry(ctx, entry);
+        if (keep != OnlyMatch::none) entries.push_back({std::move(entry.path), keep == OnlyMatch::below});
+        else if (dropped) dropped->push_back(std::move(entry));
+    }
+
+    // Sort for consistent order
+    if (ctx.options.sort == SortOrder::name) {
+        std::sort(entries.begin(), entries.end(), [](const KeptEntry& a, const KeptEntry& b) { return a.path < b.path; });
+    } else {
+        sortByKey(entries, ctx.options.sort, [](const KeptEntry& e) { return e.path.filename().string(); });
+    }
+    return listing;
+}
+
+// Totals of a folder at the depth limit, folded from a walk that is not kept
+void sizeAtLimit(ScanContext& ctx, const fs::path& current, Node& node, std::size_t depth) {
+    node.onlyBelow = false;       // not listed: whether a match lies inside is unknown
+    if (!ctx.options.sizes) return;
+    IgnoreScope ignoreScope(ctx.ignore(depth), current);
+    Totals totals;
+    if (foldTree(ctx, current, totals)) setTotals(node, totals);
+    else node.unscanned = true;
+}
+
+// Lists and stats the children of 'current' into 'node'. With sizes, the
+// entries the filters drop are folded into the totals of 'node' right away
+// (finishDirectory() adds the children's). False if the budget did not
+// allow to read the folder at all.
+bool listChildren(ScanContext& ctx, const fs::path& current, Node& node) {
+    std::vector<KeptEntry> entries;
+    std::vector<DirEntry> dropped;
+    Listing listing = listEntries(ctx, current, entries, ctx.options.sizes ? &dropped : nullptr);
+    if (listing != Listing::complete) node.unscanned = true;
+    if (listing == Listing::skipped) {
+        node.onlyBelow = false;
+        return false;
+    }
+    if (ctx.options.sizes) {
+        Totals outside;
+        if (!foldEntries(ctx, dropped, outside)) node.unscanned = true;
+        setTotals(node, outside);
+    }
+
+    node.children.reserve(entries.size());
+    for (const auto& entry : entries) {
+        Node child;
+        child.name = entry.path.filename().string();
+        child.onlyBelow = entry.onlyBelow;
+        if (statNode(ctx, entry.path, child)) node.children.push_back(std::move(child));
+    }
+    return true;
+}
+
+// True for a folder -o/--only-re kept in case of a match inside that holds nothing
+bool emptyOnlyBelow(const Node& node) {
+    return node.onlyBelow && node.children.empty() && !node.unscanned;
+}
+
+// Adds the children's totals to what listChildren() folded into 'node',
+// then drops the folders kept only in case of a match inside that were
+// empty and the children that neither match the predicates nor lead to a
+// match. Sizes count every child, dropped or not; links to folders are
+// drawn and descended, but not part of the total.
+void finishDirectory(const ScanOptions& options, Node& node) {
+    Totals totals;
+    if (node.size) {
+        totals.size = *node.size;
+        totals.files = node.files;
+        totals.folders = node.folders;
+        totals.newest = node.newest;
+    }
+    for (const Node& child : node.children) {
+        if (child.isDir && child.type == EntryType::symlink) continue;
+        if (child.size) totals.size += *child.size;
+        if (child.isDir) {
+            totals.files += child.files;
+            totals.folders += child.folders + 1;
+            totals.newest = std::max(totals.newest, child.newest);
+        } else {
+            if (child.size) ++totals.files;
+            totals.newest = std::max(totals.newest, child.mtime);
+        }
+    }
+    node.children.erase(std::remove_if(node.children.begin(), node.children.end(), emptyOnlyBelow),
+                        node.children.end());
+    if (!options.predicates.empty()) {
+        node.children.erase(std::remove_if(node.children.begin(), node.children.end(), [&](const Node& child) {
+            return child.children.empty() && !options.predicates.matches(child);
+        }), node.children.end());
+    }
+    if (options.sizes) setTotals(node, totals);
+}
+
+// Builds the filtered tree below 'current' into 'node' in one pass. With
+// sizes, directory totals are summed from the children on the way back up;
+// filtered-out entries and the levels below the depth limit are folded from
+// the same reads without being kept, so memory grows with the printed tree.
+// Predicates prune every entry that neither matches nor leads to a match,
+// after its size was counted. Folders the budget did not allow to read are
+// marked unscanned; the sizes above them only count what was read.
+void scanTree(ScanContext& ctx, const fs::path& current, Node& node, std::size_t depth) {
+    if (ctx.belowDepthLimit(depth)) {
+        sizeAtLimit(ctx, current, node, depth);
+        return;
+    }
+    IgnoreScope ignoreScope(ctx.ignore(depth), current);
+    if (!listChildren(ctx, current, node)) return;
+
+    for (Node& child : node.children) {
+        if (child.isDir) scanTree(ctx, current / child.name, child, depth + 1);
+    }
+    finishDirectory(ctx.options, node);
+}
+
+// A folder of the level being read by scanLevels()
+struct LevelDir {
+    Node* node;
+    fs::path path;
+    IgnoreStack ignore;           // frames down to its parent
+};
+
+// finishDirectory() bottom-up over what scanLevels() read. Folders at the
+// depth limit and folders the budget skipped were never listed.
+void finishLevels(const ScanOptions& options, Node& node, std::size_t depth) {
+    if (options.maxDepth && depth >= *options.maxDepth) return;
+    if (node.unscanned && node.children.empty() && !node.size) return;
+    for (Node& child : node.children) {
+        if (child.isDir) finishLevels(options, child, depth + 1);
+    }
+    finishDirectory(options, node);
+}
+
+// Breadth-first variant of scanTree(): reads all folders of one depth in
+// parallel before the next, and never opens a folder beyond maxDepth
+// (only the size walks of '-s' look deeper). Each pool worker keeps one
+// context, so with a deadline each has its own DirReader. With one
+// worker ('levelThreads' 1) the levels are read on the calling thread.
+void scanLevels(const ScanOptions& options, const fs::path& root, Node& rootNode) {
+    std::vector<LevelDir> level(1);
+    level[0].node = &rootNode;
+    level[0].path = root;
+    if (options.gitignore) level[0].ignore.init(root);
+
+    std::optional<ThreadPool> pool;
+    if (options.levelThreads != 1) pool.emplace(options.levelThreads);
+    for (std::size_t depth = 0; !level.empty(); ++depth) {
+        // Kept per folder so the next level stays in tree order
+        std::vector<std::vector<LevelDir>> next(level.size());
+        std::atomic<std::size_t> cursor{0};
+        auto work = [&] {
+            ScanContext ctx(options, root, false);
+            for (;;) {
+                const std::size_t i = cursor.fetch_add(1, std::memory_order_relaxed);
+                if (i >= level.size()) break;
+                LevelDir& dir = level[i];
+                ctx.ignoreStack = std::move(dir.ignore);
+                if (ctx.belowDepthLimit(depth)) {
+                    sizeAtLimit(ctx, dir.path, *dir.node, depth);
+                    continue;
+                }
+                IgnoreScope ignoreScope(ctx.ignore(depth), dir.path);
+                if (!listChildren(ctx, dir.path, *dir.node)) continue;
+
+                for (Node& child : dir.node->children) {
+                    if (child.isDir) next[i].push_back({&child, dir.path / child.name, ctx.ignoreStack});
+                }
+            }
+        };
+        if (pool) {
+            const std::size_t workers = std::min(pool->size(), level.size());
+            for (std::size_t w = 0; w < workers; ++w) pool->submit(work);
+            pool->wait();
+        } else {
+            work();
+        }
+
+        level.clear();
+        for (auto& children : next) {
+            for (auto& dir : children) level.push_back(std::move(dir));
+        }
+    }
+    finishLevels(options, rootNode, 0);
+}
+
+// Pushes the .gitignore frames of the folders from below the root down to
+// 'dir', for calls that start in the middle of the tree
+void enterFolder(ScanContext& ctx, const fs::path& dir) {
+    if (!ctx.options.gitignore) return;
+    std::vector<fs::path> chain;
+    for (fs::path p = dir; p != ctx.root && p != p.parent_path(); p = p.parent_path()) chain.push_back(p);
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) ctx.ignoreStack.push(*it);
+}
+
+// Hands one entry to the renderer. Folder sizes are never known here: with
+// sizes, stream() either builds the tree first or the renderer fills them in.
+void streamEntry(Renderer& renderer, const std::string& name, const std::string& rel, std::size_t depth,
+                 bool isLast, const Node& node) {
+    EntryView view;
+    view.name = name;
+    view.path = rel;
+    view.type = node.type;
+    view.isDir = node.isDir;
+    view.size = node.size;
+    view.mtime = node.mtime;
+    view.dev = node.dev;
+    view.ino = node.ino;
+    view.mtimeNs = node.mtimeNs;
+    view.ctimeNs = node.ctimeNs;
+    renderer.entry(view, depth, isLast);
+}
+
+// Walks below 'current' and streams every listed entry in display order
+void streamTree(ScanContext& ctx, Renderer& renderer, const fs::path& current, const std::string& rel,
+                std::size_t depth) {
+    // Respect depth limit: if maxDepth is set and we've reached it, stop recursion
+    if (ctx.belowDepthLimit(depth)) return;
+    IgnoreScope ignoreScope(ctx.ignore(depth), current);
+
+    std::vector<KeptEntry> entries;
+    listEntries(ctx, current, entries);
+
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        bool isLast = (i == entries.size() - 1);
+        const fs::path& path = entries[i].path;
+        std::string name = path.filename().string();
+        std::string childRel = depth == 0 ? name : rel + "/" + name;
+
+        Node node;
+        if (!statNode(ctx, path, node)) continue;
+        streamEntry(renderer, name, childRel, depth + 1, isLast, node);
+
+        // If directory then we walk it recursively
+        if (node.isDir) streamTree(ctx, renderer, path, childRel, depth + 1);
+    }
+}
+
+} // namespace
+
+Tree Scanner::scan(const fs::path& root) const {
+    ScanContext ctx(options_, root, !options_.breadthFirst);
+
+    Tree tree;
+    tree.path = root;
+    tree.root.name = root.filename().string();
+    statNode(ctx, root, tree.root);
+    tree.root.isDir = fs::is_directory(root);
+    if (tree.root.isDir && options_.breadthFirst) scanLevels(options_, root, tree.root);
+    else if (tree.root.isDir) scanTree(ctx, root, tree.root, 0);
+    return tree;
+}
+
+void Scanner::stream(const fs::path& root, Renderer& renderer) const {
+    // Predicates must know whether a folder holds a match before it is drawn
+    if (renderer.needsTree() || !options_.predicates.empty() || options_.budget || options_.breadthFirst) {
+        renderer.render(scan(root));
+        return;
+    }
+
+    // Folder sizes need the whole subtree before the folder's line anyway,
+    // and whether a folder kept in case of a match inside holds anything is
+    // only known once it was read
+    if ((options_.sizes && !options_.deferDirSizes) || options_.only.keepsFoldersBelow() ||
+        !options_.onlyRegex.empty()) {
+        renderer.render(scan(root));
+        return;
+    }
+
+    ScanContext ctx(options_, root);
+
+    Node node;
+    statNode(ctx, root, node);
+    node.isDir = fs::is_directory(root);
+    streamEntry(renderer, root.filename().string(), ".", 0, true, node);
+
+    // Start recursive scan
+    streamTree(ctx, renderer, root, std::string(), 0);
+}
+
+std::vector<Node> Scanner::list(const fs::path& root, const fs::path& dir) const {
+    ScanContext ctx(options_, root);
+    enterFolder(ctx, dir);
+
+    std::vector<KeptEntry> entries;
+    listEntries(ctx, dir, entries);
+
+    std::vector<Node> nodes;
+    for (const auto& entry : entries) {
+        Node node;
+        node.name = entry.path.filename().string();
+        if (statNode(ctx, entry.path, node)) nodes.push_back(std::move(node));
+    }
+    return nodes;
+}
+
+std::uintmax_t Scanner::size(const fs::path& root, const fs::path& dir, const std::vector<std::string>& except,
+                             Node* folders) const {
+    ScanContext ctx(options_, root);
+    enterFolder(ctx, dir);
+
+    std::vector<DirEntry> entries;
+    ctx.read(dir, entries);
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                 [&](const DirEntry& entry) {
+                                     return entry.isDir && !entry.isLink &&
+                                            std::binary_search(except.begin(), except.end(),
+                                                               entry.path.filename().string());
+                                 }),
+                  entries.end());
+    Totals totals;
+    foldEntries(ctx, entries, totals, folders);
+    return totals.size;
+}
+
+} // namespace appletree
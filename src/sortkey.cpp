@@ -0,0 +1,62 @@
+#include "appletree/sortkey.h"
+
+#include <cstring>
+
+namespace appletree {
+
+namespace {
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// A digit run sorts where its first digit would: '0', then the number of
+// significant digits (at most 255) and the digits. Shorter numbers come
+// first, equal lengths compare digit by digit.
+void appendNatural(std::string& key, std::string_view name) {
+    std::size_t i = 0;
+    while (i < name.size()) {
+        if (!isDigit(name[i])) {
+            key += name[i++];
+            continue;
+        }
+        std::size_t end = i;
+        while (end < name.size() && isDigit(name[end])) ++end;
+        std::size_t first = i;
+        while (first + 1 < end && name[first] == '0') ++first;   // "000" is the number 0
+        const std::size_t digits = std::min<std::size_t>(end - first, 255);
+        key += '0';
+        key += static_cast<char>(digits);
+        key.append(name, first, end - first);
+        i = end;
+    }
+}
+
+// strxfrm() of the whole name under the current LC_COLLATE
+void appendCollated(std::string& key, std::string_view name) {
+    const std::string text(name);
+    const std::size_t start = key.size();
+    key.resize(start + text.size() * 4 + 16);
+    std::size_t n = std::strxfrm(&key[start], text.c_str(), key.size() - start);
+    if (n >= key.size() - start) {
+        key.resize(start + n + 1);
+        n = std::strxfrm(&key[start], text.c_str(), n + 1);
+    }
+    key.resize(start + n);
+}
+
+} // namespace
+
+void appendSortKey(std::string& key, std::string_view name, SortOrder order) {
+    switch (order) {
+        case SortOrder::natural: appendNatural(key, name); break;
+        case SortOrder::locale:  appendCollated(key, name); break;
+        case SortOrder::name:    break;
+    }
+    // Ties (e.g. "a01" and "a1") fall back to byte order; the '\0' keeps
+    // the primary key a prefix that decides first
+    key += '\0';
+    key.append(name);
+}
+
+} // namespace appletree
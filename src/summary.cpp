@@ -0,0 +1,172 @@
+#include "appletree/summary.h"
+
+#include <algorithm>
+
+#include "appletree/format.h"
+#include "appletree/json.h"
+
+namespace appletree {
+
+namespace {
+
+// FNV-1a; extensions are a handful of bytes
+std::uint64_t hashKey(std::string_view s) {
+    std::uint64_t h = 0xcbf29ce484222325ULL;
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// ".gz" for "a.tar.gz"; none for "Makefile" or ".bashrc"
+std::string_view extensionOf(std::string_view name) {
+    std::size_t dot = name.rfind('.');
+    if (dot == std::string_view::npos || dot == 0) return {};
+    return name.substr(dot);
+}
+
+void appendPadded(std::string& out, std::string_view text, std::size_t width, bool right) {
+    if (right && text.size() < width) out.append(width - text.size(), ' ');
+    out += text;
+    if (!right && text.size() < width) out.append(width - text.size(), ' ');
+}
+
+// One table row: key, count and (if any) bytes, in aligned columns
+void appendRow(std::string& out, std::string_view key, std::size_t keyWidth, std::uint64_t count,
+               std::size_t countWidth, std::uint64_t bytes, bool withBytes, bool color) {
+    std::string number;
+    appendGrouped(number, count);
+    out += "   ";
+    appendPadded(out, key, keyWidth, false);
+    out += "  ";
+    appendPadded(out, number, countWidth, true);
+    if (withBytes) {
+        out += ansi(color, kFgGray);
+        out += "  ";
+        appendSize(out, bytes);
+        out += ansi(color, kReset);
+    }
+    out += '\n';
+}
+
+std::size_t groupedWidth(std::uint64_t v) {
+    std::string s;
+    appendGrouped(s, v);
+    return s.size();
+}
+
+} // namespace
+
+Summary::Summary() : slots_(16) {}
+
+Summary::Bucket& Summary::extension(std::string_view key) {
+    if (2 * (used_ + 1) > slots_.size()) grow();
+    const std::size_t mask = slots_.size() - 1;
+    for (std::size_t i = hashKey(key) & mask;; i = (i + 1) & mask) {
+        Bucket& slot = slots_[i];
+        if (!slot.used) {
+            slot.used = true;
+            slot.key.assign(key);
+            ++used_;
+            return slot;
+        }
+        if (slot.key == key) return slot;
+    }
+}
+
+void Summary::grow() {
+    std::vector<Bucket> old(slots_.size() * 2);
+    old.swap(slots_);
+    const std::size_t mask = slots_.size() - 1;
+    for (Bucket& bucket : old) {
+        if (!bucket.used) continue;
+        std::size_t i = hashKey(bucket.key) & mask;
+        while (slots_[i].used) i = (i + 1) & mask;
+        slots_[i] = std::move(bucket);
+    }
+}
+
+void Summary::add(const EntryView& entry) {
+    Bucket& type = types_[static_cast<std::size_t>(entry.type)];
+    ++type.count;
+    if (entry.isDir) return;  // folder sizes are totals of what is counted below
+
+    std::uint64_t bytes = entry.size.value_or(0);
+    type.bytes += bytes;
+    Bucket& ext = extension(extensionOf(entry.name));
+    ++ext.count;
+    ext.bytes += bytes;
+}
+
+std::vector<const Summary::Bucket*> Summary::sortedExtensions() const {
+    std::vector<const Bucket*> sorted;
+    sorted.reserve(used_);
+    for (const Bucket& slot : slots_) {
+        if (slot.used) sorted.push_back(&slot);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Bucket* a, const Bucket* b) {
+        if (a->bytes != b->bytes) return a->bytes > b->bytes;
+        if (a->count != b->count) return a->count > b->count;
+        return a->key < b->key;
+    });
+    return sorted;
+}
+
+void Summary::writeText(std::string& out, bool color) const {
+    std::vector<const Bucket*> extensions = sortedExtensions();
+    std::size_t keyWidth = 9, countWidth = 1;     // "directory"
+    for (const Bucket& type : types_) countWidth = std::max(countWidth, groupedWidth(type.count));
+    for (const Bucket* ext : extensions) {
+        keyWidth = std::max(keyWidth, ext->key.empty() ? std::size_t(6) : ext->key.size());
+        countWidth = std::max(countWidth, groupedWidth(ext->count));
+    }
+
+    const char* bold = ansi(color, kBold);
+    const char* reset = ansi(color, kReset);
+    out += "\n ";
+    out += bold;
+    out += "Summary:";
+    out += reset;
+    out += "\n  ";
+    out += bold;
+    out += "By type";
+    out += reset;
+    out += '\n';
+    for (std::size_t i = 0; i < types_.size(); ++i) {
+        if (types_[i].count == 0) continue;
+        const bool isDir = static_cast<EntryType>(i) == EntryType::directory;
+        appendRow(out, entryTypeName(static_cast<EntryType>(i)), keyWidth, types_[i].count, countWidth,
+                  types_[i].bytes, !isDir, color);
+    }
+    if (extensions.empty()) return;
+    out += "  ";
+    out += bold;
+    out += "By extension";
+    out += reset;
+    out += '\n';
+    for (const Bucket* ext : extensions) {
+        appendRow(out, ext->key.empty() ? "(none)" : ext->key, keyWidth, ext->count, countWidth, ext->bytes, true, color);
+    }
+}
+
+void Summary::writeNdjson(std::string& out) const {
+    auto record = [&out](const char* kind, std::string_view key, const Bucket& bucket) {
+        out += "{\"summary\":\"";
+        out += kind;
+        out += "\",\"key\":";
+        appendJsonString(out, key);
+        out += ",\"count\":";
+        char digits[20];
+        out.append(digits, formatUnsignedTo(digits, bucket.count));
+        out += ",\"bytes\":";
+        out.append(digits, formatUnsignedTo(digits, bucket.bytes));
+        out += "}\n";
+    };
+    for (std::size_t i = 0; i < types_.size(); ++i) {
+        if (types_[i].count > 0) record("type", entryTypeName(static_cast<EntryType>(i)), types_[i]);
+    }
+    for (const Bucket* ext : sortedExtensions()) record("extension", ext->key, *ext);
+}
+
+} // namespace appletree
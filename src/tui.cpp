@@ -0,0 +1,440 @@
+#include "appletree/tui.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "appletree/budget.h"
+#include "appletree/format.h"
+#include "appletree/pool.h"
+
+namespace appletree {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// One entry of the browser. Children are only read on first expansion.
+struct TuiNode {
+    std::string name;
+    fs::path path;
+    EntryType type = EntryType::other;
+    bool isDir = false;
+    bool isLast = true;
+    TuiNode* parent = nullptr;
+
+    bool listed = false;
+    bool expanded = false;
+    std::vector<std::unique_ptr<TuiNode>> children;
+
+    // Files: their size. Folders: -1 until the background walk that covers
+    // them finished; links to folders keep it.
+    std::int64_t size = -1;
+    // The sizes of the folders below from that walk, handed on to the
+    // children once the folder is listed
+    Node folders;
+    // Root only: its size apart from the listed subfolders, or -1
+    std::int64_t outside = -1;
+};
+
+// Shared between the UI thread and the size workers
+struct SizeJobs {
+    const Scanner* scanner = nullptr;
+    fs::path root;
+    ScanBudget stop{std::nullopt, std::nullopt};   // expired on quit
+    int wakeFd = -1;               // write end of the self-pipe
+
+    // A finished walk, picked up by collect()
+    struct Done {
+        TuiNode* node;
+        std::uintmax_t size;
+        Node folders;
+    };
+    std::mutex mutex;
+    std::vector<Done> done;
+};
+
+// Sizes 'node' apart from its subfolders in 'except' (sorted) in one walk,
+// keeping the size of every folder below
+void queueSize(ThreadPool& pool, SizeJobs& jobs, TuiNode* node, std::vector<std::string> except = {}) {
+    pool.submit([&jobs, node, except = std::move(except)] {
+        Node folders;
+        const std::uintmax_t size = jobs.scanner->size(jobs.root, node->path, except, &folders);
+        if (jobs.stop.spent()) return;   // the walk gave up
+        {
+            std::lock_guard<std::mutex> lock(jobs.mutex);
+            jobs.done.push_back({node, size, std::move(folders)});
+        }
+        char c = 0;
+        (void)!::write(jobs.wakeFd, &c, 1);   // pipe full: a redraw is pending anyway
+    });
+}
+
+// Hands the sizes of a listed folder's subfolders down from its walk,
+// further down to the ones listed as well
+void handDown(TuiNode& node, ThreadPool& pool, SizeJobs& jobs) {
+    std::vector<Node>& sized = node.folders.children;
+    std::sort(sized.begin(), sized.end(), [](const Node& a, const Node& b) { return a.name < b.name; });
+    for (auto& child : node.children) {
+        if (child->type != EntryType::directory) continue;
+        auto it = std::lower_bound(sized.begin(), sized.end(), child->name,
+                                   [](const Node& n, const std::string& name) { return n.name < name; });
+        if (it == sized.end() || it->name != child->name) {
+            // Created after the walk passed by
+            queueSize(pool, jobs, child.get());
+            continue;
+        }
+        child->size = static_cast<std::int64_t>(it->size.value_or(0));
+        child->folders = std::move(*it);
+        if (child->listed) handDown(*child, pool, jobs);
+    }
+    node.folders = Node();
+}
+
+// Stores the finished walks in the tree; the root's size once all its parts are in
+void collect(TuiNode& tree, ThreadPool& pool, SizeJobs& jobs) {
+    std::vector<SizeJobs::Done> done;
+    {
+        std::lock_guard<std::mutex> lock(jobs.mutex);
+        done.swap(jobs.done);
+    }
+    for (auto& job : done) {
+        if (job.node == &tree) {
+            tree.outside = static_cast<std::int64_t>(job.size);
+            continue;
+        }
+        job.node->size = static_cast<std::int64_t>(job.size);
+        job.node->folders = std::move(job.folders);
+        if (job.node->listed) handDown(*job.node, pool, jobs);
+    }
+
+    if (tree.size >= 0 || tree.outside < 0) return;
+    std::int64_t total = tree.outside;
+    for (auto& child : tree.children) {
+        if (child->type != EntryType::directory) continue;
+        if (child->size < 0) return;
+        total += child->size;
+    }
+    tree.size = total;
+}
+
+// Reads the children of 'node' once. Their folder sizes come from the walk
+// that sized 'node' (or one of its parents), so no folder is read twice.
+void expand(TuiNode& node, ThreadPool& pool, SizeJobs& jobs) {
+    if (!node.isDir) return;
+    node.expanded = true;
+    if (node.listed) return;
+    node.listed = true;
+
+    std::vector<Node> entries = jobs.scanner->list(jobs.root, node.path);
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        auto child = std::make_unique<TuiNode>();
+        child->name = std::move(entries[i].name);
+        child->path = node.path / child->name;
+        child->type = entries[i].type;
+        child->isDir = entries[i].isDir;
+        child->isLast = i + 1 == entries.size();
+        child->parent = &node;
+        if (!child->isDir && entries[i].size) child->size = static_cast<std::int64_t>(*entries[i].size);
+        node.children.push_back(std::move(child));
+    }
+    if (node.size >= 0) {
+        handDown(node, pool, jobs);
+    } else if (node.type != EntryType::directory) {
+        // A link to a folder: no walk went through it
+        for (auto& child : node.children) {
+            if (child->type == EntryType::directory) queueSize(pool, jobs, child.get());
+        }
+    }
+}
+
+// The root is split up: one walk per listed subfolder, one for the rest
+void sizeRoot(TuiNode& tree, ThreadPool& pool, SizeJobs& jobs) {
+    std::vector<std::string> listed;
+    for (auto& child : tree.children) {
+        if (child->type != EntryType::directory) continue;
+        listed.push_back(child->name);
+        queueSize(pool, jobs, child.get());
+    }
+    std::sort(listed.begin(), listed.end());
+    queueSize(pool, jobs, &tree, std::move(listed));
+}
+
+// Visible rows: pre-order walk over expanded folders
+void flatten(TuiNode& node, std::vector<TuiNode*>& rows) {
+    for (auto& child : node.children) {
+        rows.push_back(child.get());
+        if (child->expanded) flatten(*child, rows);
+    }
+}
+
+// Puts the terminal into raw mode on the alternate screen and restores it
+class Terminal {
+public:
+    Terminal() {
+        ok_ = ::tcgetattr(STDIN_FILENO, &saved_) == 0;
+        if (!ok_) return;
+        termios raw = saved_;
+        raw.c_lflag &= static_cast<tcflag_t>(~(ICANON | ECHO | ISIG | IEXTEN));
+        raw.c_iflag &= static_cast<tcflag_t>(~(IXON | ICRNL));
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
+        ::tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+        write("\033[?1049h\033[?25l\033[?7l");   // alternate screen, hide cursor, no wrap
+    }
+    ~Terminal() {
+        if (!ok_) return;
+        write("\033[?7h\033[?25h\033[?1049l");
+        ::tcsetattr(STDIN_FILENO, TCSAFLUSH, &saved_);
+    }
+
+    Terminal(const Terminal&) = delete;
+    Terminal& operator=(const Terminal&) = delete;
+
+    bool ok() const { return ok_; }
+
+    static void write(const std::string& s) {
+        const char* p = s.data();
+        std::size_t left = s.size();
+        while (left > 0) {
+            ssize_t n = ::write(STDOUT_FILENO, p, left);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return;
+            }
+            p += n;
+            left -= static_cast<std::size_t>(n);
+        }
+    }
+
+    static void size(std::size_t& rows, std::size_t& cols) {
+        winsize ws{};
+        if (::ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0) {
+            rows = ws.ws_row;
+            cols = ws.ws_col;
+        } else {
+            rows = 24;
+            cols = 80;
+        }
+    }
+
+private:
+    termios saved_{};
+    bool ok_ = false;
+};
+
+enum class Key {none, up, down, left, right, pageUp, pageDown, home, end, toggle, quit};
+
+// Decodes one key press from the bytes read so far
+Key decodeKey(const char* buf, ssize_t n) {
+    if (n <= 0) return Key::none;
+    if (n >= 3 && buf[0] == '\033' && (buf[1] == '[' || buf[1] == 'O')) {
+        switch (buf[2]) {
+            case 'A': return Key::up;
+            case 'B': return Key::down;
+            case 'C': return Key::right;
+            case 'D': return Key::left;
+            case 'H': return Key::home;
+            case 'F': return Key::end;
+            case '5': return Key::pageUp;
+            case '6': return Key::pageDown;
+        }
+        return Key::none;
+    }
+    switch (buf[0]) {
+        case 'k': return Key::up;
+        case 'j': return Key::down;
+        case 'h': return Key::left;
+        case 'l': case '\r': case '\n': return Key::right;
+        case ' ': return Key::toggle;
+        case 'g': return Key::home;
+        case 'G': return Key::end;
+        case 'q': case 3: case '\033': return Key::quit;   // 3 = Ctrl-C
+    }
+    return Key::none;
+}
+
+void appendNodeSize(std::string& out, const TuiNode& node) {
+    if (node.size >= 0) {
+        out += " (";
+        appendSize(out, static_cast<std::uintmax_t>(node.size));
+        out += ')';
+    } else if (node.type == EntryType::directory) {
+        out += " (…)";
+    }
+}
+
+// Connector glyphs of 'node': vertical() for every ancestor, then branch()
+void appendPrefix(std::string& out, const TuiNode& node, Theme theme) {
+    std::vector<const TuiNode*> chain;
+    for (const TuiNode* p = node.parent; p && p->parent; p = p->parent) chain.push_back(p);
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) out += vertical(theme, (*it)->isLast);
+    out += branch(theme, node.isLast);
+}
+
+void appendRow(std::string& out, const TuiNode& node, bool selected, Theme theme) {
+    out += ' ';
+    appendPrefix(out, node, theme);
+    if (selected) {
+        out += "\033[7m";
+        out += node.name;
+        if (node.isDir) out += '/';
+        out += kReset;
+    } else if (node.isDir) {
+        out += kBold;
+        out += node.name;
+        out += '/';
+        out += kReset;
+    } else {
+        out += node.name;
+    }
+    out += kFgGray;
+    appendNodeSize(out, node);
+    out += kReset;
+}
+
+void draw(TuiNode& root, const std::vector<TuiNode*>& rows, std::size_t cursor, std::size_t& top, Theme theme) {
+    std::size_t height, width;
+    Terminal::size(height, width);
+    const std::size_t visible = height > 3 ? height - 3 : 1;
+    if (cursor < top) top = cursor;
+    if (cursor >= top + visible) top = cursor - visible + 1;
+
+    std::string frame = "\033[H\033[2J";
+    frame += ' ';
+    frame += kBold;
+    frame += root.path.string();
+    frame += '/';
+    frame += kReset;
+    frame += kFgGray;
+    appendNodeSize(frame, root);
+    frame += kReset;
+    frame += "\r\n";
+
+    for (std::size_t i = top; i < rows.size() && i < top + visible; ++i) {
+        appendRow(frame, *rows[i], i == cursor, theme);
+        frame += "\r\n";
+    }
+
+    frame += "\033[";
+    char digits[20];
+    frame.append(digits, formatUnsignedTo(digits, height));
+    frame += ";1H";
+    frame += kFgGray;
+    frame += " ↑↓ move  → open  ← close/parent  space toggle  q quit";
+    frame += kReset;
+    Terminal::write(frame);
+}
+
+} // namespace
+
+int runInteractive(const fs::path& root, const ScanOptions& options, Theme theme) {
+    if (!::isatty(STDIN_FILENO) || !::isatty(STDOUT_FILENO)) {
+        std::cerr << "Error: '-i' needs a terminal on stdin and stdout.\n";
+        return 1;
+    }
+
+    int wake[2];
+    if (::pipe(wake) != 0) {
+        std::cerr << "Error: Cannot create the wake-up pipe for '-i'.\n";
+        return 1;
+    }
+    ::fcntl(wake[0], F_SETFL, O_NONBLOCK);
+    ::fcntl(wake[1], F_SETFL, O_NONBLOCK);
+
+    TuiNode tree;
+    tree.name = root.filename().string();
+    tree.path = root;
+    tree.type = EntryType::directory;
+    tree.isDir = true;
+
+    SizeJobs jobs;
+    ScanOptions scanOptions = options;
+    scanOptions.budget = &jobs.stop;
+    const Scanner scanner(std::move(scanOptions));
+    jobs.scanner = &scanner;
+    jobs.root = root;
+    jobs.wakeFd = wake[1];
+    {
+        // Declared after 'tree': the workers are joined before the nodes go away
+        ThreadPool pool;
+        Terminal terminal;
+
+        expand(tree, pool, jobs);
+        sizeRoot(tree, pool, jobs);
+
+        std::vector<TuiNode*> rows;
+        std::size_t cursor = 0, top = 0;
+        bool running = terminal.ok();
+        while (running) {
+            rows.clear();
+            flatten(tree, rows);
+            if (cursor >= rows.size()) cursor = rows.empty() ? 0 : rows.size() - 1;
+            draw(tree, rows, cursor, top, theme);
+
+            pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {wake[0], POLLIN, 0}};
+            if (::poll(fds, 2, 1000) < 0 && errno != EINTR) break;   // timeout: redraw after resize
+
+            if (fds[1].revents & POLLIN) {
+                char drain[256];
+                while (::read(wake[0], drain, sizeof(drain)) > 0) {}
+                collect(tree, pool, jobs);
+            }
+            if (!(fds[0].revents & POLLIN)) continue;
+
+            char buf[16];
+            ssize_t n = ::read(STDIN_FILENO, buf, sizeof(buf));
+            std::size_t height, width;
+            Terminal::size(height, width);
+            const std::size_t page = height > 4 ? height - 4 : 1;
+            TuiNode* current = rows.empty() ? nullptr : rows[cursor];
+
+            switch (decodeKey(buf, n)) {
+                case Key::up:       if (cursor > 0) --cursor; break;
+                case Key::down:     if (cursor + 1 < rows.size()) ++cursor; break;
+                case Key::pageUp:   cursor = cursor > page ? cursor - page : 0; break;
+                case Key::pageDown: cursor = std::min(cursor + page, rows.empty() ? 0 : rows.size() - 1); break;
+                case Key::home:     cursor = 0; break;
+                case Key::end:      cursor = rows.empty() ? 0 : rows.size() - 1; break;
+                case Key::right:
+                    if (current) expand(*current, pool, jobs);
+                    break;
+                case Key::toggle:
+                    if (current && current->expanded) current->expanded = false;
+                    else if (current) expand(*current, pool, jobs);
+                    break;
+                case Key::left:
+                    if (current && current->expanded) {
+                        current->expanded = false;
+                    } else if (current && current->parent != &tree) {
+                        // Jump to the parent row
+                        auto it = std::find(rows.begin(), rows.end(), current->parent);
+                        if (it != rows.end()) cursor = static_cast<std::size_t>(it - rows.begin());
+                    }
+                    break;
+                case Key::quit:     running = false; break;
+                case Key::none:     break;
+            }
+        }
+
+        // Unfinished walks give up at their next folder
+        jobs.stop.expire();
+    }
+    ::close(wake[0]);
+    ::close(wake[1]);
+    return 0;
+}
+
+} // namespace appletree
@@ -0,0 +1,34 @@
+#include "appletree/writer.h"
+
+#include <cerrno>
+#include <unistd.h>
+
+namespace appletree {
+
+OutputWriter::OutputWriter(int fd, std::size_t capacity) : fd_(fd), capacity_(capacity) {
+    // Leave room for the line that crosses the threshold
+    buf_.reserve(capacity_ + 4096);
+}
+
+OutputWriter::~OutputWriter() {
+    flush();
+}
+
+void OutputWriter::flush() {
+    if (fd_ < 0) return;
+    const char* p = buf_.data();
+    std::size_t left = buf_.size();
+    while (left > 0 && !failed_) {
+        ssize_t n = ::write(fd_, p, left);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            failed_ = true;
+            break;
+        }
+        p += n;
+        left -= static_cast<std::size_t>(n);
+    }
+    buf_.clear();
+}
+
+} // namespace appletree